@@ -2,6 +2,7 @@
 
 out vec4 FragColor;
 
+// Member order follows the std140 mirrors in light.h
 struct DirLight {
     vec3 direction;
 	
@@ -12,52 +13,70 @@ struct DirLight {
 
 struct PointLight {
 	vec3 position;
-
 	float constant;
-	float linear;
-	float quadratic;
-
 	vec3 ambient;
+	float linear;
 	vec3 diffuse;
+	float quadratic;
 	vec3 specular;
 };
 
 #define NR_POINT_LIGHTS 2
 
+// Member order follows MaterialGPU in material.h
 struct Material {
-	vec3 ambient;
 	vec3 diffuse;
-	vec3 specular;
 	float shininess;
+	vec3 specular;
+	int layer;
+	vec4 uvRect;
 };
 
-in vec3 vertexColor;
+#define MAX_MATERIALS 256
+
+in vec4 vertexColor;
 in vec2 texCoord;
 in vec3 FragPos;
 in vec3 FragNormal;
+flat in uint vertexMaterial;
+
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+	DirLight dirLight;
+	PointLight pointLights[NR_POINT_LIGHTS];
+	int pointLightCount;
+};
+
+layout (std140) uniform Materials {
+	Material materials[MAX_MATERIALS];
+};
 
-uniform sampler2D tex0;
-uniform vec3 viewPos;
-uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+uniform sampler2DArray tex0;
+Material material;
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()	{	
+	material = materials[vertexMaterial];
 	vec3 norm = normalize(FragNormal);
 	vec3 viewDir = normalize(viewPos - FragPos);
 
 	vec3 result = CalcDirLight(dirLight, norm, viewDir);
 
-	for (int i = 0; i < NR_POINT_LIGHTS; i++) {
+	for (int i = 0; i < pointLightCount; i++) {
 		result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
 	}
 
-	result *= vertexColor;
+	result *= vertexColor.rgb;
 
-	FragColor = texture(tex0, texCoord) * vec4(result, 1.0);
+	vec2 layerCoord = material.uvRect.xy + texCoord * material.uvRect.zw;
+	FragColor = texture(tex0, vec3(layerCoord, material.layer)) * vec4(result, vertexColor.a);
 }
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
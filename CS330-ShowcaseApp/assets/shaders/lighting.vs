@@ -1,24 +1,33 @@
 #version 330 core
 
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 color;
+layout (location = 1) in vec4 color;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
+// Rows of the model matrix, vec4(position, 1.0) * model transforms to world space
+layout (location = 4) in mat3x4 model;
+layout (location = 7) in mat3 normalMatrix;
+layout (location = 10) in vec4 tint;
+layout (location = 11) in uint materialIndex;
 
-out vec3 vertexColor;
+out vec4 vertexColor;
 out vec2 texCoord;
 out vec3 FragPos;
 out vec3 FragNormal;
+flat out uint vertexMaterial;
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 model;
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
 		
 void main()	{
-	FragPos = vec3(model * vec4(position, 1.0));
-	FragNormal = mat3(transpose(inverse(model))) * normal;
+	FragPos = vec4(position, 1.0) * model;
+	FragNormal = normalMatrix * normal;
 	gl_Position = projection * view * vec4(FragPos, 1.0);
 
-	vertexColor = color;
+	vertexColor = color * tint;
 	texCoord = uv;
-}
\ No newline at end of file
+	vertexMaterial = materialIndex;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <bounds.h>
+
+struct RayHit {
+	uint32_t userData{};
+	float distance{};
+};
+
+struct AabbTreeUpdate {
+	int32_t proxy{};
+	BoundingBox box{};
+};
+
+enum class AabbTreeUpdatePolicy {
+	// Reinsert when few leaves moved, refit when many did and rebuild once the tree has degraded
+	Auto,
+	Reinsert,
+	Refit,
+	Rebuild,
+};
+
+struct AabbTreeStats {
+	uint32_t reinserted{};
+	uint32_t refit{};
+	uint32_t rebuilds{};
+};
+
+// Dynamic bounding volume hierarchy in the style of Box2D's b2DynamicTree. Leaves are stored
+// with a margin so small moves do not touch the tree, inserts pick the sibling with the
+// lowest surface area cost and rotations keep it balanced. Proxies stay valid across
+// refits and rebuilds until they are removed.
+class AabbTree {
+public:
+	static constexpr int32_t Null = -1;
+
+	int32_t Insert(const BoundingBox& box, uint32_t userData);
+	void Remove(int32_t proxy);
+	// Reinserts the leaf when the box left its margin, returns whether it did
+	bool Move(int32_t proxy, const BoundingBox& box);
+	// Updates the leaf in place and grows or shrinks its ancestors, the structure is kept
+	void Refit(int32_t proxy, const BoundingBox& box);
+	// Top down binned SAH build over the current leaves
+	void Rebuild();
+	// Applies one frame of moves with the given policy
+	void Update(std::span<const AabbTreeUpdate> updates, AabbTreeUpdatePolicy policy = AabbTreeUpdatePolicy::Auto);
+
+	// Appends the user data of every leaf that might be visible, large trees are walked in
+	// parallel, so two queries on one tree must not run at the same time
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const;
+	void QueryOverlap(const BoundingBox& box, std::vector<uint32_t>& results) const;
+	// Closest leaf whose tight box the ray enters within maxDistance, direction does not need to be normalized
+	std::optional<RayHit> Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	uint32_t UserData(int32_t proxy) const { return _nodes[proxy].userData; }
+	const BoundingBox& Bounds(int32_t proxy) const { return _nodes[proxy].tight; }
+
+	size_t LeafCount() const { return _leafCount; }
+	int32_t Height() const { return _root == Null ? 0 : _nodes[_root].height; }
+	// Surface area of the internal nodes relative to the root, lower traverses faster
+	float Cost() const;
+	const AabbTreeStats& Stats() const { return _stats; }
+
+private:
+	struct Node {
+		// Fattened for leaves, the union of the children for internal nodes
+		BoundingBox box{};
+		BoundingBox tight{};
+		int32_t parent{ Null };
+		int32_t left{ Null };
+		int32_t right{ Null };
+		// 0 for leaves, -1 while on the free list
+		int32_t height{ -1 };
+		uint32_t userData{};
+
+		bool IsLeaf() const { return left == Null; }
+	};
+
+	int32_t allocateNode();
+	void freeNode(int32_t node);
+	void insertLeaf(int32_t leaf);
+	void removeLeaf(int32_t leaf);
+	int32_t balance(int32_t node);
+	void refitAncestors(int32_t node);
+	void refitAll(int32_t node);
+	int32_t build(std::span<int32_t> leaves);
+	BoundingBox fatten(const BoundingBox& box) const;
+	void queryFrustum(const Frustum& frustum, int32_t root, std::vector<uint32_t>& results) const;
+
+private:
+	std::vector<Node> _nodes{};
+	int32_t _root{ Null };
+	int32_t _freeList{ Null };
+	size_t _leafCount{};
+	// Cost right after the last rebuild, Auto rebuilds once refits have pushed it well past this
+	float _builtCost{};
+	AabbTreeStats _stats{};
+	// Scratch for parallel frustum queries
+	mutable std::vector<int32_t> _querySubtrees{};
+	mutable std::vector<uint32_t> _queryResults{};
+	// Offset and count of each subtree's results
+	mutable std::vector<std::pair<size_t, size_t>> _querySpans{};
+};
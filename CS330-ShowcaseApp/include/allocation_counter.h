@@ -0,0 +1,21 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Counts heap allocations on every thread by replacing the global operator new. Only the
+// benchmark links it, the application keeps the default allocator. Aligned new is not counted.
+class AllocationCounter {
+public:
+	static void Reset() {
+		_allocations.store(0, std::memory_order_relaxed);
+		_bytes.store(0, std::memory_order_relaxed);
+	}
+	static uint64_t Allocations() { return _allocations.load(std::memory_order_relaxed); }
+	static uint64_t Bytes() { return _bytes.load(std::memory_order_relaxed); }
+
+private:
+	friend void* countedAllocate(size_t size);
+
+	static inline std::atomic<uint64_t> _allocations{};
+	static inline std::atomic<uint64_t> _bytes{};
+};
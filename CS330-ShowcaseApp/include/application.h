@@ -1,26 +1,45 @@
 #pragma once
 
+#include <filesystem>
 #include <string>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <aabb_tree.h>
 #include <camera.h>
+#include <file_watcher.h>
 #include <light.h>
 #include <object.h>
+#include <render_queue.h>
+#include <scene.h>
+#include <scene_description.h>
 #include <shader.h>
 #include <texture.h>
+#include <uniform_buffer.h>
 
 class Application {
+	friend class Benchmark;
 public:
 	Application(std::string WindowTitle, int width, int height);
 	void Run();
+	// Objects and lights, assets/scenes/desk.txt unless set. Edits to it are applied while running.
+	void SetSceneDescription(std::filesystem::path path) { _sceneDescription = std::move(path); }
+	// Maps the scene from this binary file instead of building it from the description, it is
+	// written there when missing, out of date or older than the description
+	void SetSceneFile(std::filesystem::path path) { _sceneFile = std::move(path); }
 
 private:
 	bool openWindow();
+	void setupGraphicsState();
 	void setupInputs();
 	void setupScene();
+	void reloadScene();
 	bool update(double deltaTime);
 	bool draw();
+	void updateScene();
+	// Deletes every GL object the application owns while the context is still current
+	void releaseGraphics();
+	void pickObject(double xpos, double ypos);
 	void handleInput(double deltaTime);
 	void mousePositionCallback(double xpos, double ypox);
 	void incrementCameraSpeed(float amount);
@@ -35,7 +54,24 @@ private:
 	float _cameraSpeed{ 5.f };
 	glm::vec2 _cameraAngleSpeed;
 	Camera _camera;
-	std::vector<Object> _objects;
+	Scene _scene{};
+	std::filesystem::path _sceneDescription{};
+	std::filesystem::path _sceneFile{};
+	SceneBuilder _sceneBuilder{};
+	FileWatcher _sceneWatcher{};
+	// Loaded from _sceneFile rather than built by _sceneBuilder
+	bool _sceneMapped{ false };
+	// Spatial index over the scene's renderables, userData is the renderable index
+	AabbTree _sceneTree{};
+	std::vector<int32_t> _treeProxies{};
+	// Scene generation the proxies were made for
+	uint32_t _treeGeneration{};
+	std::vector<AabbTreeUpdate> _treeUpdates{};
+	AabbTreeUpdatePolicy _treeUpdatePolicy{ AabbTreeUpdatePolicy::Auto };
+	std::vector<uint32_t> _visibleRenderables{};
+	// Above 1 keeps finer levels of detail further away, [ and ] halve and double it
+	float _lodBias{ 1.f };
+	RenderQueue _renderQueue{};
 	bool _running { false };
 
 	double _lastFrameTime{ -1 };
@@ -44,4 +80,7 @@ private:
 
 	DirectionalLight _dirLight{};
 	std::vector<PointLight> _pointLights {};
+
+	UniformBuffer<CameraBlock> _cameraBuffer{};
+	UniformBuffer<LightsBlock> _lightsBuffer{};
 };
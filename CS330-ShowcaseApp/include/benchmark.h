@@ -0,0 +1,106 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <application.h>
+
+struct BenchmarkOptions {
+	int frames{ 300 };
+	int warmupFrames{ 10 };
+	int width{ 800 };
+	int height{ 600 };
+	// Extra copies of the book stacked behind the desk, for instancing and culling stress tests
+	int books{ 0 };
+	// Books at the front of the stacks that slide every frame, for the object tree update benchmarks
+	int movingBooks{ 0 };
+	// Copies of the ball in rows going away from the desk, for the level of detail benchmarks
+	int balls{ 0 };
+	float lodBias{ 1.f };
+	// Procedural primitives loaded through the geometry cache in one batch after setup, not drawn
+	int primitives{ 0 };
+	AabbTreeUpdatePolicy treeUpdatePolicy{ AabbTreeUpdatePolicy::Auto };
+	// Drop packets outside the view frustum before sorting
+	bool frustumCulling{ true };
+	// Submit through glMultiDrawElementsIndirect when the context supports it
+	bool multiDrawIndirect{ true };
+	// Layout every mesh of the scene is uploaded in
+	VertexFormat vertexFormat{ VertexFormat::Packed };
+	// Job system threads including the render thread, 0 for one per core
+	int threads{ 0 };
+	// Only cook assets/textures into the texture cache and exit
+	bool cookTextures{ false };
+	// Binary scene the desk is mapped from, written on the first run
+	std::filesystem::path scene{};
+	// Text scene built instead of assets/scenes/desk.txt
+	std::filesystem::path description{};
+	// Second version of the description applied after setup, as a hot reload would
+	std::filesystem::path reloadDescription{};
+	std::filesystem::path output{};
+	std::filesystem::path screenshot{};
+};
+
+// Drives Application::setupScene / Application::draw offscreen along a scripted camera path
+// and reports frame timings and GL traffic as JSON.
+class Benchmark {
+public:
+	Benchmark(BenchmarkOptions options);
+	int Run();
+
+	static bool ParseArguments(int argc, char** argv, BenchmarkOptions& options);
+
+private:
+	// Milliseconds since setup started
+	struct SetupSample {
+		double setupMs{};
+		double firstFrameMs{};
+		double texturesReadyMs{};
+		uint64_t bytesUploaded{};
+		double primitivesMs{};
+		double reloadMs{};
+		uint64_t reloadBytesUploaded{};
+		SceneReloadStats reload{};
+	};
+
+	struct FrameSample {
+		double cpuMs{};
+		// Scene systems, run before the timed part of the frame
+		double systemsMs{};
+		double sceneUpdateMs{};
+		double finishMs{};
+		// Heap allocations on any thread, from the systems to the end of the frame
+		uint64_t allocations{};
+		uint64_t glCalls{};
+		uint64_t drawCalls{};
+		uint64_t bytesUploaded{};
+		uint32_t culled{};
+		uint32_t visible{};
+		uint32_t batches{};
+		uint32_t triangles{};
+		uint32_t lodSwitches{};
+		uint32_t treeReinserted{};
+		uint32_t treeRefit{};
+		uint32_t treeRebuilds{};
+		uint32_t worldMatrixUpdates{};
+		uint32_t normalMatrixInverses{};
+		uint32_t stateChanges{};
+		int32_t stateChangesSaved{};
+	};
+
+	// User component on the books that move, index picks the stack slot
+	struct SlidingBook {
+		int index{};
+	};
+
+	void placeCamera(Camera& camera, int frame);
+	void addBooks(Application& app);
+	void addBalls(Application& app);
+	void loadPrimitives();
+	glm::mat4 bookTransform(int book, float slide);
+	void slideBooks(Scene& scene);
+	std::string toJson(Application& app, const SetupSample& setup, const std::vector<FrameSample>& samples, const std::vector<WorkerStats>& workers);
+
+private:
+	BenchmarkOptions _options;
+	int _frame{};
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include <types.h>
+
+struct BoundingBox {
+	glm::vec3 min{};
+	glm::vec3 max{};
+
+	static BoundingBox FromVertices(std::span<const Vertex> vertices);
+
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+	glm::vec3 Extents() const { return (max - min) * 0.5f; }
+	float SurfaceArea() const;
+	BoundingBox Merged(const BoundingBox& other) const { return { glm::min(min, other.min), glm::max(max, other.max) }; }
+	bool Contains(const BoundingBox& other) const { return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::lessThanEqual(other.max, max)); }
+	bool Overlaps(const BoundingBox& other) const { return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max)); }
+	// Box around the transformed box, still axis aligned
+	BoundingBox Transformed(const glm::mat4& transform) const;
+};
+
+struct BoundingSphere {
+	glm::vec3 center{};
+	float radius{};
+
+	// Centered on the box, which is tighter than Ritter's sphere for the boxy meshes this app builds
+	static BoundingSphere FromVertices(std::span<const Vertex> vertices, const BoundingBox& box);
+
+	// Radius grows with the largest axis scale, so non-uniform scales give a loose sphere
+	BoundingSphere Transformed(const glm::mat4& transform) const;
+};
+
+// Axis aligned boxes in structure of arrays layout, the way Frustum::Cull reads them
+struct BoundingBoxes {
+	std::vector<float> centerX{};
+	std::vector<float> centerY{};
+	std::vector<float> centerZ{};
+	std::vector<float> extentX{};
+	std::vector<float> extentY{};
+	std::vector<float> extentZ{};
+
+	void Clear();
+	void Push(const BoundingBox& box);
+	// Resize then Set lets parallel jobs fill disjoint indices
+	void Resize(size_t count);
+	void Reserve(size_t count);
+	void Set(size_t index, const BoundingBox& box);
+	size_t Size() const { return centerX.size(); }
+};
+
+enum class Containment {
+	Outside,
+	Intersects,
+	Inside,
+};
+
+// Six planes facing inwards, extracted from a projection * view matrix
+class Frustum {
+public:
+	Frustum() = default;
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// Inside lets hierarchies accept a whole subtree without testing its children
+	Containment Classify(const BoundingBox& box) const;
+	bool Intersects(const BoundingBox& box) const;
+	bool Intersects(const BoundingSphere& sphere) const;
+
+	// Writes 1 for every box at least partly inside and 0 for the rest. Tests four boxes per
+	// iteration with SSE where available.
+	void Cull(const BoundingBoxes& boxes, std::vector<uint8_t>& visible) const;
+	// Same over boxes [first, last), visible is indexed like boxes
+	void Cull(const BoundingBoxes& boxes, size_t first, size_t last, uint8_t* visible) const;
+
+private:
+	// xyz is the normalized plane normal, w the distance
+	std::array<glm::vec4, 6> _planes{};
+};
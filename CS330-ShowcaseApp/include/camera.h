@@ -23,6 +23,8 @@ public:
 	glm::vec3 GetPosition() { return _position; }
 
 	void SetAspectRatio(float aspectRatio) { _aspectRatio = aspectRatio; }
+	void SetPosition(glm::vec3 position) { _position = position; }
+	void LookAt(glm::vec3 target);
 	bool IsPerspective() const { return _isPerspective;  }
 	void SetIsPerspective(bool isPerspective) { _isPerspective = isPerspective;  }
 	void MoveCamera(MoveDirection direction, float moveAmount);
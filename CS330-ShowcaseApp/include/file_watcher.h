@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+
+// Tells when a file was written or replaced. Uses inotify on Linux, where the directory is watched
+// so editors that save by renaming over the file are seen too. Elsewhere Changed compares the
+// modification time.
+class FileWatcher {
+public:
+	FileWatcher() = default;
+	explicit FileWatcher(const std::filesystem::path& path);
+	~FileWatcher();
+	FileWatcher(FileWatcher&& other) noexcept;
+	FileWatcher& operator=(FileWatcher&& other) noexcept;
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool IsValid() const { return !_path.empty(); }
+	// Never blocks. True once for any number of writes since the last call.
+	bool Changed();
+
+private:
+	void close();
+
+private:
+	std::filesystem::path _path{};
+#ifdef __linux__
+	int _descriptor{ -1 };
+#else
+	std::filesystem::file_time_type _lastWrite{};
+#endif
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+#include <gl_handle.h>
+#include <types.h>
+
+// First fit free list over a range of elements. Freed blocks are merged with their neighbours
+// right away so that creating and destroying meshes at runtime does not fragment the arena.
+class RangeAllocator {
+public:
+	RangeAllocator() = default;
+	explicit RangeAllocator(uint32_t capacity);
+
+	std::optional<uint32_t> Allocate(uint32_t size);
+	void Free(uint32_t offset, uint32_t size);
+	// Appends the new space to the free list, a block touching the old end is extended
+	void Grow(uint32_t newCapacity);
+
+	uint32_t Capacity() const { return _capacity; }
+	uint32_t Used() const { return _used; }
+	size_t FreeBlockCount() const { return _freeBlocks.size(); }
+	uint32_t LargestFreeBlock() const;
+
+private:
+	uint32_t _capacity{};
+	uint32_t _used{};
+	// offset -> size
+	std::map<uint32_t, uint32_t> _freeBlocks{};
+};
+
+// Sub-allocated span of one arena pool. Indices are relative to baseVertex.
+struct GeometryRange {
+	uint32_t baseVertex{};
+	uint32_t vertexCount{};
+	uint32_t firstIndex{};
+	uint32_t indexCount{};
+	VertexFormat format{ VertexFormat::Float };
+	// GL_UNSIGNED_SHORT when the range has fewer than 65536 vertices
+	GLenum indexType{ GL_UNSIGNED_INT };
+};
+
+// Vertex and index buffers shared by every mesh, drawn with glDrawElementsBaseVertex. Meshes are
+// pooled by vertex format and index type, each pool has its own buffers and VAO so meshes of one
+// pool can still be drawn back to back without rebinding. Buffers grow by doubling when a range
+// does not fit.
+class GeometryArena {
+public:
+	static GeometryArena& Get();
+
+	// Packs the vertices into the given format, indices are narrowed to 16 bits when they fit
+	GeometryRange Allocate(VertexFormat format, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+	// Same for vertices already packed into the format and indices already of the type, which are copied into the buffers as they are
+	GeometryRange Upload(VertexFormat format, GLenum indexType, uint32_t vertexCount, const void* vertices, uint32_t indexCount, const void* indices);
+	// Reads a range back in its packed format
+	void Read(const GeometryRange& range, std::vector<std::byte>& vertices, std::vector<std::byte>& indices);
+	void Free(const GeometryRange& range);
+
+	void Bind(const GeometryRange& range);
+	// Points the per-instance attributes at InstanceData in the given buffer, expects a pool to be bound
+	void SetInstanceBuffer(GLuint buffer, GLintptr offset);
+	GLuint VertexArray(const GeometryRange& range) const;
+
+	// Small and stable, meant for sort keys
+	static uint32_t PoolIndex(const GeometryRange& range);
+	static size_t VertexSize(VertexFormat format);
+	static size_t IndexSize(GLenum indexType) { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+	// Vertex and index storage taken by live ranges, over all pools
+	uint64_t UsedBytes() const;
+	// Deletes every pool before the context goes away, ranges still in use become invalid
+	void Release();
+
+private:
+	struct Pool {
+		VertexFormat format{};
+		GLenum indexType{};
+		GLVertexArray vertexArrayObject{};
+		GLBuffer vertexBufferObject{};
+		GLBuffer elementBufferObject{};
+		RangeAllocator vertices{};
+		RangeAllocator indices{};
+	};
+
+	GeometryArena() = default;
+
+	Pool& pool(VertexFormat format, GLenum indexType);
+	void createPool(Pool& pool);
+	void growVertices(Pool& pool, uint32_t minimumCapacity);
+	void growIndices(Pool& pool, uint32_t minimumCapacity);
+	void setupVertexArray(const Pool& pool);
+	void setupInstanceAttributes();
+
+private:
+	static constexpr uint32_t initialVertexCapacity = 1 << 16;
+	static constexpr uint32_t initialIndexCapacity = 3 << 16;
+	// Three vertex formats times two index types, created on first use
+	static constexpr size_t poolCount = 6;
+
+	std::array<Pool, poolCount> _pools{};
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include <mesh.h>
+#include <types.h>
+
+enum class Primitive : uint8_t {
+	Box,
+	Circle,
+	Cylinder,
+	Sphere
+};
+
+// Everything a procedural mesh is generated from, dimensions a primitive does not use stay 0
+struct PrimitiveParams {
+	Primitive type{ Primitive::Box };
+	// Box: width, height, depth. Circle: radius. Cylinder: height, top radius, bottom radius. Sphere: radius.
+	std::array<float, 3> dimensions{};
+	uint32_t stacks{};
+	uint32_t sectors{};
+	std::array<float, 4> color{ 1.f, 1.f, 1.f, 1.f };
+	VertexFormat format{ Mesh::DefaultVertexFormat };
+	// Reorder for the vertex cache and overdraw with MeshOptimizer, on the worker that generates it
+	bool optimize{ true };
+
+	auto operator<=>(const PrimitiveParams&) const = default;
+
+	static PrimitiveParams Box(float width, float height, float depth, const glm::vec4& color = glm::vec4{ 1.f });
+	static PrimitiveParams Circle(float radius, uint32_t sectors, const glm::vec4& color = glm::vec4{ 1.f });
+	static PrimitiveParams Cylinder(float height, float topRadius, float bottomRadius, uint32_t sectors, const glm::vec4& color = glm::vec4{ 1.f });
+	static PrimitiveParams Sphere(float radius, uint32_t stacks, uint32_t sectors, const glm::vec4& color = glm::vec4{ 1.f });
+};
+
+struct GeometryCacheStats {
+	uint32_t hits{};
+	uint32_t misses{};
+};
+
+// Procedural meshes by the parameters they were generated from. Asking twice returns the same
+// range of the geometry arena, so equal primitives also draw as instances of each other. The misses
+// of a batch are tessellated in parallel on the job system, uploads stay on the calling thread.
+class GeometryCache {
+public:
+	static constexpr uint32_t MaxLodLevels = 4;
+	// Levels stop before a circle would get fewer sectors or a sphere fewer stacks than these
+	static constexpr uint32_t MinLodSectors = 6;
+	static constexpr uint32_t MinLodStacks = 4;
+	// Longest a sector edge may get on screen before the next finer level is needed
+	static constexpr float LodEdgePixels = 6.f;
+
+	static GeometryCache& Get();
+
+	Mesh Load(const PrimitiveParams& params);
+	// Same order as params
+	std::vector<Mesh> Load(std::span<const PrimitiveParams> params);
+	// Load(params) with its chain of coarser levels attached, boxes have none
+	Mesh LoadLods(const PrimitiveParams& params);
+
+	// Frees every cached range, meshes handed out before must not be drawn afterwards
+	void Clear();
+
+	size_t Size() const { return _meshes.size(); }
+	const GeometryCacheStats& Stats() const { return _stats; }
+
+private:
+	struct MeshData {
+		std::vector<Vertex> vertices{};
+		std::vector<uint32_t> indices{};
+	};
+
+	GeometryCache() = default;
+
+	static std::vector<PrimitiveParams> lodLevels(const PrimitiveParams& params);
+	static void generate(const PrimitiveParams& params, MeshData& data);
+	static void generateBox(const PrimitiveParams& params, MeshData& data);
+	static void generateCircle(const PrimitiveParams& params, MeshData& data);
+	static void generateCylinder(const PrimitiveParams& params, MeshData& data);
+	static void generateSphere(const PrimitiveParams& params, MeshData& data);
+
+private:
+	std::map<PrimitiveParams, Mesh> _meshes{};
+	std::map<PrimitiveParams, std::unique_ptr<MeshLods>> _lods{};
+	GeometryCacheStats _stats{};
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <glad/glad.h>
+
+// Optional features on top of the 3.3 core context we ask for. Drivers usually hand out a newer
+// context anyway, or expose the features as ARB extensions which GLAD does not load by itself.
+struct GLCapabilities {
+	// glDrawElementsInstancedBaseVertexBaseInstance, GL 4.2 or ARB_base_instance
+	bool baseInstance{ false };
+	// glMultiDrawElementsIndirect with per command baseInstance, GL 4.3 or ARB_multi_draw_indirect
+	bool multiDrawIndirect{ false };
+	// BC1-BC3 texture formats, EXT_texture_compression_s3tc
+	bool textureCompressionS3TC{ false };
+	// glGetProgramBinary and glProgramBinary with at least one binary format, GL 4.1 or ARB_get_program_binary
+	bool programBinary{ false };
+	// Compile and link status can be polled without blocking, KHR/ARB_parallel_shader_compile
+	bool parallelShaderCompile{ false };
+
+	static const GLCapabilities& Get();
+	// Must be called after GLAD has loaded the core entry points, loads missing extension entry points with the same loader
+	static void Detect(GLADloadproc load);
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+struct GLCounterValues {
+	uint64_t glCalls{ 0 };
+	uint64_t drawCalls{ 0 };
+	uint64_t bytesUploaded{ 0 };
+};
+
+// Counts GL traffic by wrapping the GLAD entry points. Only the benchmark installs it,
+// the application itself calls straight into the driver.
+class GLCounters {
+public:
+	// Must be called after GLAD has loaded the entry points
+	static void Install();
+	static void Reset() { _values = {}; }
+	static const GLCounterValues& Values() { return _values; }
+
+private:
+	template <auto* Slot, typename Fn, bool IsDraw> friend struct GLHook;
+	friend struct GLUploadHooks;
+
+	static inline GLCounterValues _values{};
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <glad/glad.h>
+
+enum class GLObjectType : uint8_t {
+	Buffer,
+	VertexArray,
+	Texture,
+	Program,
+	Framebuffer,
+	Renderbuffer,
+	Count
+};
+
+// Counts the GL objects alive per type, so objects still around once everything was released
+// show up at shutdown. Debug builds also keep the names for the report.
+class GLLeakTracker {
+public:
+	static void Created(GLObjectType type, GLuint name);
+	static void Destroyed(GLObjectType type, GLuint name);
+	static size_t Live(GLObjectType type);
+	static size_t Live();
+	// Lists what is still alive, returns how many objects that is
+	static size_t Report(std::ostream& out);
+};
+
+GLuint CreateGLObject(GLObjectType type);
+void DeleteGLObject(GLObjectType type, GLuint name);
+
+// Owns one GL object and deletes it when destroyed. Move only, the context has to be current
+// wherever one is destroyed or reset.
+template <GLObjectType Type>
+class GLHandle {
+public:
+	GLHandle() = default;
+	// Takes over a name created elsewhere
+	explicit GLHandle(GLuint name) : _name{ name } {
+		if (_name) {
+			GLLeakTracker::Created(Type, _name);
+		}
+	}
+	~GLHandle() { Reset(); }
+
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+	GLHandle(GLHandle&& other) noexcept : _name{ std::exchange(other._name, 0) } {}
+	GLHandle& operator=(GLHandle&& other) noexcept {
+		if (this != &other) {
+			Reset();
+			_name = std::exchange(other._name, 0);
+		}
+		return *this;
+	}
+
+	static GLHandle Create() { return GLHandle{ CreateGLObject(Type) }; }
+
+	GLuint Get() const { return _name; }
+	explicit operator bool() const { return _name != 0; }
+
+	void Reset() {
+		if (_name) {
+			GLLeakTracker::Destroyed(Type, _name);
+			DeleteGLObject(Type, _name);
+			_name = 0;
+		}
+	}
+
+private:
+	GLuint _name{};
+};
+
+using GLBuffer = GLHandle<GLObjectType::Buffer>;
+using GLVertexArray = GLHandle<GLObjectType::VertexArray>;
+using GLTexture = GLHandle<GLObjectType::Texture>;
+using GLProgram = GLHandle<GLObjectType::Program>;
+using GLFramebuffer = GLHandle<GLObjectType::Framebuffer>;
+using GLRenderbuffer = GLHandle<GLObjectType::Renderbuffer>;
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <gl_handle.h>
+
+// Offscreen GL 3.3 core context for running the renderer without a window.
+// Linux uses a surfaceless EGL display (llvmpipe works), other platforms fall back to a hidden GLFW window.
+class HeadlessContext {
+public:
+	HeadlessContext(int width, int height);
+	~HeadlessContext();
+
+	bool IsValid() const { return _valid; }
+	void Bind();
+	std::vector<uint8_t> ReadPixels();
+
+private:
+	bool createContext();
+	void createFramebuffer();
+
+private:
+	int _width{};
+	int _height{};
+	bool _valid{ false };
+
+	void* _display{ nullptr };
+	void* _context{ nullptr };
+
+	GLFramebuffer _framebuffer{};
+	GLRenderbuffer _colorBuffer{};
+	GLRenderbuffer _depthBuffer{};
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Recycles the blocks jobs are allocated in, so scheduling stops touching the heap once enough
+// jobs were in flight at the same time
+template <typename T>
+class JobAllocator {
+public:
+	using value_type = T;
+
+	JobAllocator() = default;
+	template <typename U>
+	JobAllocator(const JobAllocator<U>&) {}
+
+	T* allocate(size_t count) {
+		if (count == 1) {
+			std::lock_guard lock{ _mutex };
+			if (_free) {
+				return reinterpret_cast<T*>(std::exchange(_free, _free->next));
+			}
+		}
+		return static_cast<T*>(::operator new(std::max(count * sizeof(T), sizeof(FreeBlock))));
+	}
+
+	void deallocate(T* block, size_t count) {
+		if (count != 1) {
+			::operator delete(block);
+			return;
+		}
+		std::lock_guard lock{ _mutex };
+		_free = new (block) FreeBlock{ _free };
+	}
+
+	template <typename U>
+	bool operator==(const JobAllocator<U>&) const { return true; }
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	static inline std::mutex _mutex{};
+	static inline FreeBlock* _free{};
+};
+
+// The ranges of a blocking ParallelFor, on the stack of the thread waiting for them
+struct JobRanges {
+	void (*function)(void* context, size_t begin, size_t end);
+	void* context;
+	std::atomic<size_t> remaining;
+};
+
+class Job {
+	friend class JobSystem;
+public:
+	bool IsFinished() const { return _finished.load(std::memory_order_acquire); }
+
+private:
+	// Jobs hold either work or one range of a blocking ParallelFor
+	std::function<void()> _work{};
+	JobRanges* _ranges{};
+	size_t _begin{};
+	size_t _end{};
+	// Unfinished dependencies, plus one held by Schedule until every dependency is registered
+	std::atomic<uint32_t> _pending{ 1 };
+	std::atomic<bool> _finished{ false };
+	// Guards the dependents and the transition to finished
+	std::mutex _mutex{};
+	// Jobs waiting on this one, taken by whoever finishes it. The first few are stored inline.
+	std::array<std::shared_ptr<Job>, 4> _dependents{};
+	uint32_t _dependentCount{};
+	std::vector<std::shared_ptr<Job>> _moreDependents{};
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+struct WorkerStats {
+	// Time spent running jobs since the last ResetStats, and its share of the time since then
+	double busyMs{};
+	double utilization{};
+	uint64_t jobs{};
+	// Jobs taken from the front of another worker's queue
+	uint64_t steals{};
+};
+
+// Work stealing scheduler. Every worker owns a queue, pushes and pops its own jobs at the back
+// and steals from the front of the others once it runs dry. The thread that calls Start is
+// worker 0 and only runs jobs while it waits, so GL calls stay on it. Until Start, or with one
+// thread, everything runs on that thread inside Wait and ParallelFor.
+class JobSystem {
+public:
+	static JobSystem& Get();
+
+	JobSystem();
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Starts threadCount - 1 threads next to the calling one, 0 picks one per core
+	void Start(uint32_t threadCount = 0);
+	void Stop();
+	uint32_t ThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+	// 0 on the thread that called Start and on threads outside the pool
+	static uint32_t WorkerIndex();
+
+	// Runs once every dependency finished, empty handles count as finished
+	JobHandle Schedule(std::function<void()> work, std::span<const JobHandle> dependencies = {});
+	// Calls work(begin, end) over [0, count) in ranges of at least grainSize. The handle finishes
+	// after the last range.
+	JobHandle ScheduleParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> work, std::span<const JobHandle> dependencies = {});
+	// Runs queued jobs on the calling thread until the job finished
+	void Wait(const JobHandle& job);
+	// ScheduleParallelFor and Wait without allocating, counts that fit in one range run inline.
+	// Work is called as work(begin, end).
+	template <typename Work>
+	void ParallelFor(size_t count, size_t grainSize, Work&& work) {
+		using Function = std::remove_reference_t<Work>;
+		parallelFor(count, grainSize, [](void* context, size_t begin, size_t end) {
+			(*static_cast<Function*>(context))(begin, end);
+		}, const_cast<void*>(static_cast<const void*>(&work)));
+	}
+
+	std::vector<WorkerStats> Stats() const;
+	void ResetStats();
+
+private:
+	// Ring buffer, only grows
+	class JobQueue {
+	public:
+		bool Empty() const { return _count == 0; }
+		JobHandle& operator[](size_t index) { return _jobs[(_head + index) & (_jobs.size() - 1)]; }
+		void Reserve(size_t capacity);
+		void PushBack(JobHandle job);
+		JobHandle PopBack();
+		JobHandle PopFront();
+
+	private:
+		std::vector<JobHandle> _jobs{};
+		size_t _head{};
+		size_t _count{};
+	};
+
+	struct Worker {
+		std::mutex mutex{};
+		JobQueue jobs{};
+		std::thread thread{};
+		std::atomic<uint64_t> busyNanoseconds{};
+		std::atomic<uint64_t> jobCount{};
+		std::atomic<uint64_t> steals{};
+	};
+
+	void parallelFor(size_t count, size_t grainSize, void (*function)(void* context, size_t begin, size_t end), void* context);
+	static JobHandle makeJob();
+	void workerLoop(uint32_t index);
+	void enqueue(JobHandle job);
+	JobHandle findJob(uint32_t index);
+	void run(const JobHandle& job, uint32_t index);
+	void finish(const JobHandle& job);
+
+private:
+	std::vector<std::unique_ptr<Worker>> _workers{};
+	std::atomic<bool> _running{ false };
+	// Jobs sitting in any queue, sleeping workers wake when it turns positive
+	std::atomic<uint64_t> _queued{};
+	std::mutex _sleepMutex{};
+	std::condition_variable _wake{};
+	std::chrono::steady_clock::time_point _statsStart{ std::chrono::steady_clock::now() };
+};
@@ -1,6 +1,11 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
 
+// Must match NR_POINT_LIGHTS in lighting.fs
+constexpr size_t MaxPointLights = 2;
+
 struct DirectionalLight {
 	glm::vec3 direction { 0.f, -1.0f, 0.f };
 
@@ -18,3 +23,58 @@ struct PointLight {
 	float linear{ 0.09f };
 	float quadratic{ 0.032f };
 };
+
+// std140 mirrors of the lights as laid out in the Lights uniform block of lighting.fs.
+// Every vec3 starts a new 16 byte slot, the scalars fill the gap behind it.
+struct DirectionalLightGPU {
+	glm::vec3 direction{};
+	float _padding0{};
+	glm::vec3 ambient{};
+	float _padding1{};
+	glm::vec3 diffuse{};
+	float _padding2{};
+	glm::vec3 specular{};
+	float _padding3{};
+
+	DirectionalLightGPU() = default;
+	DirectionalLightGPU(const DirectionalLight& light) :
+		direction{ light.direction },
+		ambient{ light.ambient },
+		diffuse{ light.diffuse },
+		specular{ light.specular }
+	{}
+};
+
+struct PointLightGPU {
+	glm::vec3 position{};
+	float constant{};
+	glm::vec3 ambient{};
+	float linear{};
+	glm::vec3 diffuse{};
+	float quadratic{};
+	glm::vec3 specular{};
+	float _padding{};
+
+	PointLightGPU() = default;
+	PointLightGPU(const PointLight& light) :
+		position{ light.position },
+		constant{ light.constant },
+		ambient{ light.ambient },
+		linear{ light.linear },
+		diffuse{ light.diffuse },
+		quadratic{ light.quadratic },
+		specular{ light.specular }
+	{}
+};
+
+struct LightsBlock {
+	DirectionalLightGPU dirLight{};
+	PointLightGPU pointLights[MaxPointLights]{};
+	int32_t pointLightCount{};
+	int32_t _padding[3]{};
+};
+
+static_assert(sizeof(DirectionalLightGPU) == 64, "DirLight must match std140");
+static_assert(sizeof(PointLightGPU) == 64, "PointLight must match std140");
+static_assert(offsetof(PointLightGPU, specular) == 48, "PointLight must match std140");
+static_assert(offsetof(LightsBlock, pointLightCount) == 64 + 64 * MaxPointLights, "Lights must match std140");
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsValid() const { return _data != nullptr; }
+	std::span<const uint8_t> Data() const { return { _data, _size }; }
+
+private:
+	void close();
+
+private:
+	const uint8_t* _data{ nullptr };
+	size_t _size{ 0 };
+#ifdef _WIN32
+	void* _file{ nullptr };
+	void* _mapping{ nullptr };
+#endif
+};
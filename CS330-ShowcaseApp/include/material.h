@@ -1,9 +1,29 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <shader.h>
 #include <texture.h>
 
+// Must match MAX_MATERIALS in lighting.fs, 48 bytes each stays well below the 16 KB uniform block minimum
+constexpr size_t MaxMaterials = 256;
+
+// std140 mirror of MaterialData in lighting.fs
+struct MaterialGPU {
+	glm::vec3 diffuse{};
+	float shininess{};
+	glm::vec3 specular{};
+	int32_t layer{};
+	glm::vec4 uvRect{ 0.f, 0.f, 1.f, 1.f };
+};
+
+struct MaterialsBlock {
+	MaterialGPU materials[MaxMaterials];
+};
+
+static_assert(sizeof(MaterialGPU) == 48, "Material must match std140");
+static_assert(offsetof(MaterialGPU, uvRect) == 32, "Material must match std140");
+
 class Material {
 public:
 	Material(
@@ -15,10 +35,19 @@ public:
 	Material(
 		std::shared_ptr<Texture> texture
 	);
-	void Bind(Shader shader);
+	// Parameters as read by the shader from the Materials block, including where the texture lives in its array
+	MaterialGPU GPU() const;
+
+	uint32_t Id() const { return _id; }
+	const std::shared_ptr<Texture>& GetTexture() const { return _texture; }
+	const glm::vec3& Ambient() const { return _ambient; }
+	const glm::vec3& Diffuse() const { return _diffuse; }
+	const glm::vec3& Specular() const { return _specular; }
+	bool IsTranslucent() const { return _texture->IsTranslucent(); }
 public:
 	float shininess{ 32.f };
 private:
+	uint32_t _id;
 	std::shared_ptr<Texture> _texture;
 	glm::vec3 _ambient;
 	glm::vec3 _diffuse;
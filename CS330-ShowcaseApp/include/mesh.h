@@ -1,28 +1,84 @@
 #pragma once
 #include <vector>
 #include <types.h>
+#include <bounds.h>
+#include <geometry_arena.h>
 #include <glad/glad.h>
 
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+struct MeshLods;
+
 class Mesh {
+	friend class GeometryCache;
 public:
-	Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
-	Mesh(GLenum mode, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// optimize reorders the vertices and indices with MeshOptimizer before upload, triangle lists only
+	Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, VertexFormat format = DefaultVertexFormat, bool optimize = false);
+	Mesh(GLenum mode, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, VertexFormat format = DefaultVertexFormat, bool optimize = false);
+	// Takes over geometry that is already in the arena
+	Mesh(GLenum mode, const GeometryRange& range, const BoundingBox& bounds, const BoundingSphere& sphere)
+		: _mode{ mode }, _range{ range }, _bounds{ bounds }, _sphere{ sphere } {}
 
+	// Format of meshes created without one, which includes every Create* mesh
+	static inline VertexFormat DefaultVertexFormat = VertexFormat::Packed;
+
+	// Come from GeometryCache, equal arguments return the same geometry which the cache releases.
+	// Round primitives carry a chain of coarser levels, see Lods().
 	static Mesh CreateBox(float width, float height, float depth, glm::vec4 color = {1.f, 1.f, 1.f, 1.f});
 	static Mesh CreateCircle(float radius, uint32_t sectors, glm::vec4 color = { 1.f, 1.f, 1.f, 1.f });
 	static Mesh CreateCylinder(float height, float topRadius, float bottomRadius, uint32_t sectors, glm::vec4 color = { 1.f, 1.f, 1.f, 1.f });
-	static Mesh CreateCone(float height, float radius, uint32_t sectors, glm::vec4 color = { 1.f, 1.f, 1.f, 1.f }) { CreateCylinder(height, 0, radius, sectors, color); }
+	static Mesh CreateCone(float height, float radius, uint32_t sectors, glm::vec4 color = { 1.f, 1.f, 1.f, 1.f }) { return CreateCylinder(height, 0, radius, sectors, color); }
 	static Mesh CreateSphere(float radius, uint32_t stacks, uint32_t sectors, glm::vec4 color = { 1.f, 1.f, 1.f, 1.f });
 
-	void Draw();
+	// Returns the range to the arena, copies of the mesh must not be drawn afterwards
+	void Release();
+
+	void Bind();
+	// Expects the vertex array to be bound with Bind() and instance attributes to be set
+	void DrawInstanced(GLsizei instanceCount, GLuint baseInstance = 0);
+	// Same draw recorded for a multi-draw indirect buffer
+	DrawElementsIndirectCommand IndirectCommand(GLuint instanceCount, GLuint baseInstance) const {
+		return { _range.indexCount, instanceCount, _range.firstIndex, (GLint)_range.baseVertex, baseInstance };
+	}
+	GLenum Mode() const { return _mode; }
+	GLenum IndexType() const { return _range.indexType; }
+
+	// Meshes with the same pool and id share geometry and can be drawn as instances of each other
+	uint32_t GeometryPool() const { return GeometryArena::PoolIndex(_range); }
+	uint32_t GeometryId() const { return _range.firstIndex; }
+	bool SharesGeometry(const Mesh& other) const {
+		return _mode == other._mode && GeometryPool() == other.GeometryPool() && _range.firstIndex == other._range.firstIndex
+			&& _range.baseVertex == other._range.baseVertex && _range.indexCount == other._range.indexCount;
+	}
+
+	GLuint VertexArray() const { return GeometryArena::Get().VertexArray(_range); }
+	// In mesh space, before Transform
+	const BoundingBox& Bounds() const { return _bounds; }
+	const BoundingSphere& Sphere() const { return _sphere; }
+	const GeometryRange& Range() const { return _range; }
+	// Coarser versions of this mesh, null when it has none
+	const MeshLods* Lods() const { return _lods; }
 
 	glm::mat4 Transform{ 1.f };
 
 private:
 	GLenum _mode;
-	size_t _elementCount {0};
-	GLuint _vertexBufferObject {};
-	GLuint _shaderProgram {};
-	GLuint _vertexArrayObject {};
-	GLuint _elementBufferObject {};
+	GeometryRange _range {};
+	BoundingBox _bounds {};
+	BoundingSphere _sphere {};
+	const MeshLods* _lods {};
+};
+
+// Level 0 is the mesh itself, every level after it has about half the sectors of the one before
+struct MeshLods {
+	std::vector<Mesh> levels{};
+	// Projected height up to which level 0 still looks round, each level after it halves it
+	float fullDetailPixels{};
 };
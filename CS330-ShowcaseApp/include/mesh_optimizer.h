@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <types.h>
+
+// Post-transform cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+	// Vertices transformed per triangle, 0.5 is the best a large regular mesh can get and 3 the worst
+	float acmr{};
+	// Vertices transformed per vertex referenced, 1 is perfect
+	float atvr{};
+};
+
+struct MeshOptimizerReport {
+	uint32_t vertices{};
+	uint32_t triangles{};
+	uint32_t clusters{};
+	VertexCacheStats before{};
+	VertexCacheStats after{};
+};
+
+// Reorders triangle lists for the GPU before upload. Tipsify (Sander, Nehab and Barczak 2007) orders the
+// triangles for the post-transform cache and splits them into clusters wherever the cache would not
+// suffer, the clusters are then sorted so outward facing ones draw first and occlude the rest. Last,
+// vertices are renumbered in the order the indices first use them so fetches walk the buffer forward.
+class MeshOptimizer {
+public:
+	static constexpr uint32_t CacheSize = 16;
+	// A cluster may end once its own ACMR is within this factor of the whole mesh's
+	static constexpr float ClusterThreshold = 1.05f;
+
+	// All three passes, vertices the indices never use are dropped
+	static MeshOptimizerReport Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Returns where each cluster starts, in triangles
+	static std::vector<uint32_t> OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+	// Splits the clusters further where the cache allows and sorts them, returns how many there were
+	static uint32_t OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, std::span<const uint32_t> clusters);
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+
+	static VertexCacheStats Analyze(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = CacheSize);
+
+	// Keeps the report of every mesh optimized from now on, for the benchmark. Reports come back
+	// sorted by size, not in the order the meshes were optimized.
+	static void RecordReports(bool record);
+	static std::vector<MeshOptimizerReport> Reports();
+
+private:
+	static inline std::mutex _reportMutex{};
+	static inline bool _recording{ false };
+	static inline std::vector<MeshOptimizerReport> _reports{};
+};
@@ -1,15 +1,19 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 #include <mesh.h>
-#include <shader.h>
 #include <material.h>
 
+// Meshes sharing a material, placed relative to their object. Scene::Spawn turns models into entities.
 class Model {
 public:
 	Model(std::shared_ptr<Material> material);
 	Model(std::shared_ptr<Material> material, std::vector<Mesh> meshes);
-	void Draw(Shader shader, glm::mat4 transform = glm::mat4{ 1.f });
+
+	const std::vector<Mesh>& Meshes() const { return _meshes; }
+	const std::shared_ptr<Material>& GetMaterial() const { return _material; }
+
 	glm::mat4 Transform { 1.f };
 private:
 	std::vector<Mesh> _meshes{};
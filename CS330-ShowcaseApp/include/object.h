@@ -1,25 +1,17 @@
 #pragma once
 
-#include <glm/glm.hpp>
-#include <vector>
-#include <model.h>
-#include <shader.h>
+#include <scene.h>
 
+// Factories for the desk scene. Each spawns an entity per object, model and mesh and returns the root.
 class Object {
 public:
-	Object(std::vector<Model> models);
-	void Update(float deltaTime) {};
-	void Draw(Shader shader);
+	Object() = delete;
 
-	static Object CreatePlane();
-	static Object CreateStand();
-	static Object CreateBook();
-	static Object CreateClock();
-	static Object CreateJewel();
-	static Object CreateBall();
-	static Object CreateMonitor();
-public:
-	glm::mat4 Transform{ 1.f };
-private:
-	std::vector<Model> _models{};
-};
\ No newline at end of file
+	static Entity CreatePlane(Scene& scene);
+	static Entity CreateStand(Scene& scene);
+	static Entity CreateBook(Scene& scene);
+	static Entity CreateClock(Scene& scene);
+	static Entity CreateJewel(Scene& scene);
+	static Entity CreateBall(Scene& scene);
+	static Entity CreateMonitor(Scene& scene);
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <glad/glad.h>
+
+#include <gl_handle.h>
+
+// Linked programs kept as glGetProgramBinary blobs in cache/shaders, in files named after a hash of
+// the sources and the driver's vendor, renderer and version strings. A hit skips compiling and linking.
+// Does nothing where the driver offers no binary formats.
+class ProgramCache {
+public:
+	// An empty handle on a miss, or when the driver rejects the blob it wrote before
+	static GLProgram Load(const std::string& vertexSource, const std::string& fragmentSource);
+	// The program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static void Store(GLuint program, const std::string& vertexSource, const std::string& fragmentSource);
+
+	static const std::filesystem::path cachePath;
+
+private:
+	static uint64_t hash(const std::string& vertexSource, const std::string& fragmentSource);
+	static std::filesystem::path cachedFile(uint64_t key);
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <bounds.h>
+#include <gl_handle.h>
+#include <material.h>
+#include <mesh.h>
+#include <shader.h>
+#include <types.h>
+#include <uniform_buffer.h>
+
+struct DrawPacket {
+	uint64_t key{};
+	Shader* shader{};
+	Material* material{};
+	Texture* texture{};
+	Mesh* mesh{};
+	glm::mat4 transform{ 1.f };
+	glm::vec4 tint{ 1.f };
+	float depth{};
+};
+
+struct RenderQueueStats {
+	uint32_t packets{};
+	// Packets outside the view frustum, dropped before sorting
+	uint32_t culled{};
+	uint32_t visible{};
+	// Instanced draws, packets sharing mesh and texture array are merged into one
+	uint32_t batches{};
+	// Over every instance drawn
+	uint32_t triangles{};
+	// Draw calls issued, with multi-draw indirect all batches of a texture array share one
+	uint32_t drawCalls{};
+	// Distinct materials uploaded to the Materials block
+	uint32_t materials{};
+	// Instances whose transform needed a full inverse for the normal matrix
+	uint32_t normalMatrixInverses{};
+	// Program, texture array and geometry pool switches issued after sorting
+	uint32_t stateChanges{};
+	// Switches the same packets would have needed in submission order
+	uint32_t unsortedStateChanges{};
+
+	// Negative when back to front ordering of translucent packets costs more than sorting saved
+	int32_t StateChangesSaved() const { return static_cast<int32_t>(unsortedStateChanges) - static_cast<int32_t>(stateChanges); }
+};
+
+// Collects draw packets for a frame, drops the ones outside the view frustum, sorts the rest by a 64 bit key and submits them with
+// redundant state changes skipped. Material parameters are uploaded once per frame into the
+// Materials block and picked per instance, so materials are not state: runs of packets with the
+// same mesh and texture array become a single instanced draw, their transforms, tints and material
+// indices are streamed in one instance buffer upload. When the context supports it, every batch of a
+// texture array is recorded into a command buffer and submitted with one glMultiDrawElementsIndirect,
+// otherwise batches are drawn one by one.
+//
+// Opaque key:      [63] 0 | [57-62] program | [47-56] texture array | [44-46] geometry pool | [25-43] mesh | [0-24] depth, front to back
+// Translucent key: [63] 1 | [47-62] depth, back to front | [41-46] program | [31-40] texture array | [28-30] geometry pool | [9-27] mesh
+// Translucent depth keeps 16 bits (about 1% precision) so packets at almost the same depth still group by state.
+class RenderQueue {
+public:
+	void Begin(const glm::vec3& viewPosition, const glm::mat4& viewProjection);
+	void Push(Shader& shader, Material& material, Mesh& mesh, const glm::mat4& transform, const glm::vec4& tint = glm::vec4{ 1.f });
+	// Room for count packets, returns the index of the first. Set fills them and is safe from
+	// parallel jobs as long as each index is set once.
+	size_t Allocate(size_t count);
+	// Capacity for the most packets a frame can submit, a culled frame then never grows a buffer
+	void Reserve(size_t count);
+	void Set(size_t index, Shader& shader, Material& material, Mesh& mesh, const glm::mat4& transform, const glm::vec4& tint = glm::vec4{ 1.f });
+	// Culling and instance building are split over the job system, GL calls stay on the calling thread
+	void Flush();
+
+	// Falls back to one draw per batch when disabled or unsupported, both paths draw the same image
+	void SetMultiDrawIndirect(bool enabled) { _multiDrawIndirect = enabled; }
+	bool UsesMultiDrawIndirect() const;
+
+	void SetFrustumCulling(bool enabled) { _frustumCulling = enabled; }
+	bool UsesFrustumCulling() const { return _frustumCulling; }
+
+	const RenderQueueStats& Stats() const { return _stats; }
+	// Deletes the GL buffers, they are created again by the next Flush
+	void Release();
+
+private:
+	uint64_t makeKey(const DrawPacket& packet) const;
+	void cull();
+	uint32_t countStateChanges() const;
+	// Returns whether it needed a full inverse
+	static bool normalMatrix(const glm::mat4& transform, glm::mat3& normal);
+	uint32_t materialIndex(const Material& material);
+	void uploadInstances();
+	void uploadCommands();
+	void drawBatches(size_t first, size_t last, bool indirect);
+
+private:
+	struct SortEntry {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// Run of sorted packets drawn as instances of one mesh
+	struct Batch {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	glm::vec3 _viewPosition{};
+	Frustum _frustum{};
+	bool _frustumCulling{ true };
+	BoundingBoxes _worldBounds{};
+	std::vector<uint8_t> _visible{};
+	std::vector<DrawPacket> _packets{};
+	std::vector<SortEntry> _order{};
+	std::vector<InstanceData> _instances{};
+	std::vector<Batch> _batches{};
+	std::vector<DrawElementsIndirectCommand> _commands{};
+	GLBuffer _instanceBuffer{};
+	size_t _instanceBufferCapacity{};
+	GLBuffer _commandBuffer{};
+	size_t _commandBufferCapacity{};
+	bool _multiDrawIndirect{ true };
+
+	// Material in each slot of the Materials block, reassigned every frame
+	std::vector<const Material*> _slotMaterials{};
+	MaterialsBlock _materials{};
+	UniformBuffer<MaterialsBlock> _materialsBuffer{};
+
+	RenderQueueStats _stats{};
+};
@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <bounds.h>
+#include <job_system.h>
+#include <material.h>
+#include <mesh.h>
+#include <model.h>
+#include <render_queue.h>
+#include <shader.h>
+#include <transform_hierarchy.h>
+
+// Entities are the nodes of the scene's transform hierarchy, the id indexes every per entity array
+using Entity = uint32_t;
+
+class ComponentPoolBase {
+public:
+	virtual ~ComponentPoolBase() = default;
+	virtual void Clear() = 0;
+	// Drops the components of count entities from first on and renumbers the ones after them
+	virtual void Erase(Entity first, uint32_t count) = 0;
+};
+
+// Sparse set, components are packed for linear scans and found by entity through a slot table
+template <typename T>
+class ComponentPool : public ComponentPoolBase {
+public:
+	static constexpr uint32_t Empty = UINT32_MAX;
+
+	T& Add(Entity entity, T component) {
+		if (entity >= _slots.size()) {
+			_slots.resize(entity + 1, Empty);
+		}
+		if (_slots[entity] != Empty) {
+			return _components[_slots[entity]] = std::move(component);
+		}
+
+		_slots[entity] = static_cast<uint32_t>(_components.size());
+		_entities.push_back(entity);
+		return _components.emplace_back(std::move(component));
+	}
+
+	// Moves the last component into the hole, so the order of a pool is not stable
+	void Remove(Entity entity) {
+		if (!Has(entity)) {
+			return;
+		}
+
+		auto slot = _slots[entity];
+		if (slot + 1 != _components.size()) {
+			_components[slot] = std::move(_components.back());
+			_entities[slot] = _entities.back();
+			_slots[_entities[slot]] = slot;
+		}
+		_components.pop_back();
+		_entities.pop_back();
+		_slots[entity] = Empty;
+	}
+
+	bool Has(Entity entity) const { return entity < _slots.size() && _slots[entity] != Empty; }
+	T* Find(Entity entity) { return Has(entity) ? &_components[_slots[entity]] : nullptr; }
+
+	// Same order in both, Entities()[i] owns Components()[i]
+	std::span<T> Components() { return _components; }
+	std::span<const Entity> Entities() const { return _entities; }
+	size_t Size() const { return _components.size(); }
+
+	void Erase(Entity first, uint32_t count) override {
+		for (auto entity = first; entity < first + count; entity++) {
+			Remove(entity);
+		}
+		for (auto& entity : _entities) {
+			if (entity >= first + count) {
+				entity -= count;
+			}
+		}
+		if (first < _slots.size()) {
+			_slots.erase(_slots.begin() + first, _slots.begin() + std::min<size_t>(first + count, _slots.size()));
+		}
+	}
+
+	void Clear() override {
+		_slots.clear();
+		_entities.clear();
+		_components.clear();
+	}
+
+private:
+	std::vector<uint32_t> _slots{};
+	std::vector<Entity> _entities{};
+	std::vector<T> _components{};
+};
+
+class Scene;
+using System = std::function<void(Scene& scene, float deltaTime)>;
+
+// A subtree copied out of a scene, parents first. Keeps the mesh and material indices rather than
+// new copies, so every instance shares them and the subtree can be destroyed in the meantime.
+struct ScenePrefab {
+	struct Node {
+		glm::mat4 local{ 1.f };
+		// Index into nodes, Scene::Null for the root
+		uint32_t parent{};
+		// Scene::Null when the node draws nothing
+		uint32_t mesh{};
+		uint32_t material{};
+		glm::vec4 tint{ 1.f };
+	};
+	std::vector<Node> nodes{};
+};
+
+// Entity and component store. Transforms live in the hierarchy, renderables and their boxes in
+// packed arrays of their own and anything else in one ComponentPool per type. Systems run as
+// jobs, each after the systems it names, the rest in parallel.
+class Scene {
+	friend class SceneFile;
+public:
+	static constexpr Entity Null = TransformHierarchy::None;
+
+	// The parent has to exist already
+	Entity Create(const glm::mat4& transform = glm::mat4{ 1.f }, Entity parent = Null);
+	// Root with a child per model and a renderable grandchild per mesh, returns the root
+	Entity Spawn(const std::vector<Model>& models, const glm::mat4& transform = glm::mat4{ 1.f });
+	// Copies the entity and its descendants, sharing their meshes and materials. User components
+	// are not copied. Needs the subtree to have been created in one go, as Spawn and Clone do.
+	Entity Clone(Entity root, Entity parent = Null);
+	// Same requirement as Clone, empty when it is not met
+	ScenePrefab Capture(Entity root) const;
+	Entity Instantiate(const ScenePrefab& prefab, Entity parent = Null);
+	// Removes the entity, its descendants, their renderables and components. Entities created after
+	// it move down by the size of the subtree and renderables are renumbered. Meshes, materials and
+	// their arena ranges stay even when nothing draws them anymore, so code that rebuilds objects has
+	// to reuse them by index, as SceneBuilder does with its prefabs and primitives.
+	void Destroy(Entity root);
+	// Drops every entity, mesh, material and component, systems stay
+	void Clear();
+	// Changes whenever renderables are removed, indices kept from before may point elsewhere now
+	uint32_t Generation() const { return _generation; }
+
+	size_t EntityCount() const { return _transforms.Size(); }
+	Entity Parent(Entity entity) const { return _transforms.Parent(entity); }
+	const glm::mat4& GetTransform(Entity entity) const { return _transforms.Local(entity); }
+	void SetTransform(Entity entity, const glm::mat4& transform) { _transforms.SetLocal(entity, transform); }
+	// Valid after UpdateTransforms
+	const glm::mat4& WorldTransform(Entity entity) const { return _transforms.World(entity); }
+	// Applies to every renderable at or below the entity
+	void SetTint(Entity entity, const glm::vec4& tint);
+
+	uint32_t AddMesh(Mesh mesh);
+	// A LOD chain, finest level first. Returns the index of level 0, the others follow it.
+	uint32_t AddMeshLevels(std::span<const Mesh> levels, float fullDetailPixels);
+	uint32_t AddMaterial(std::shared_ptr<Material> material);
+	// An entity has at most one renderable
+	uint32_t AddRenderable(Entity entity, uint32_t mesh, uint32_t material, const glm::vec4& tint = glm::vec4{ 1.f });
+	size_t RenderableCount() const { return _renderEntities.size(); }
+	Entity RenderableEntity(uint32_t renderable) const { return _renderEntities[renderable]; }
+	// World space, valid after UpdateTransforms
+	const BoundingBox& RenderableBounds(uint32_t renderable) const { return _worldBounds[renderable]; }
+
+	template <typename T>
+	T& Add(Entity entity, T component) { return Components<T>().Add(entity, std::move(component)); }
+	template <typename T>
+	void Remove(Entity entity) { Components<T>().Remove(entity); }
+	template <typename T>
+	T* Find(Entity entity) { return Components<T>().Find(entity); }
+	template <typename T>
+	ComponentPool<T>& Components() {
+		auto& pool = _components[std::type_index{ typeid(T) }];
+		if (!pool) {
+			pool = std::make_unique<ComponentPool<T>>();
+		}
+		return static_cast<ComponentPool<T>&>(*pool);
+	}
+
+	// Runs after the systems named in after, which have to be added first. Systems with no order
+	// between them may run at the same time and must not write the same components. Adding a
+	// name that exists replaces that system and keeps its place.
+	void AddSystem(std::string name, System system, const std::vector<std::string>& after = {});
+	void RemoveSystem(const std::string& name);
+	// Returns once every system finished
+	void RunSystems(float deltaTime);
+
+	// Recomputes the world matrices and boxes of whatever moved or was added. Returns the
+	// renderables whose box changed, valid until the next call.
+	std::span<const uint32_t> UpdateTransforms();
+	uint32_t WorldMatrixUpdates() const { return _worldMatrixUpdates; }
+
+	// Picks the level of every renderable whose mesh has a LOD chain from the height its bounding
+	// sphere projects to. Renderables under one parent switch together so caps stay on their
+	// cylinders. A bias above 1 keeps the finer levels further away. Needs UpdateTransforms.
+	void SelectLods(const glm::vec3& viewPosition, const glm::mat4& projection, float viewportHeight, float bias = 1.f);
+	// Renderables that changed level in the last SelectLods
+	uint32_t LodSwitches() const { return _lodSwitches; }
+
+	// Pushes every renderable, or only the listed ones, building the packets on the job system
+	void Submit(RenderQueue& queue, Shader& shader);
+	void Submit(RenderQueue& queue, Shader& shader, std::span<const uint32_t> renderables);
+
+private:
+	void submit(RenderQueue& queue, Shader& shader, size_t packet, uint32_t renderable);
+
+private:
+	TransformHierarchy _transforms{};
+	// Per entity, one past the last descendant and the renderable if there is one
+	std::vector<Entity> _subtreeEnds{};
+	std::vector<uint32_t> _renderables{};
+
+	// Per renderable
+	std::vector<Entity> _renderEntities{};
+	std::vector<uint32_t> _renderMeshes{};
+	std::vector<uint32_t> _renderMaterials{};
+	std::vector<glm::vec4> _renderTints{};
+	// Drawn mesh is _renderMeshes + level, the coarser levels are stored right after their mesh
+	std::vector<uint8_t> _renderLevels{};
+	std::vector<BoundingBox> _localBounds{};
+	std::vector<BoundingBox> _worldBounds{};
+
+	std::vector<Mesh> _meshes{};
+	// Per mesh, 1 unless a LOD chain follows it
+	std::vector<uint8_t> _meshLevels{};
+	std::vector<float> _meshLodPixels{};
+	// Renderables with a LOD chain in the order they were added, so siblings are next to each other
+	std::vector<uint32_t> _lodRenderables{};
+	std::vector<float> _lodTargets{};
+	uint32_t _lodSwitches{};
+	std::vector<std::shared_ptr<Material>> _materials{};
+	std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>> _components{};
+	struct SystemEntry {
+		std::string name{};
+		System system{};
+		std::vector<std::string> after{};
+	};
+	std::vector<SystemEntry> _systems{};
+	std::vector<JobHandle> _systemJobs{};
+	std::vector<JobHandle> _systemDependencies{};
+	float _deltaTime{};
+
+	uint32_t _generation{};
+
+	std::vector<uint32_t> _changedNodes{};
+	std::vector<uint32_t> _changedRenderables{};
+	uint32_t _worldMatrixUpdates{};
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include <geometry_cache.h>
+#include <light.h>
+#include <scene.h>
+
+struct SceneMaterialDescription {
+	// Below assets/textures
+	std::string texture{ "debug.png" };
+	glm::vec3 ambient{ 1.f };
+	glm::vec3 diffuse{ 1.f };
+	glm::vec3 specular{ 1.f };
+	float shininess{ 32.f };
+
+	bool operator==(const SceneMaterialDescription&) const = default;
+};
+
+struct SceneObjectDescription {
+	// Matches the object between versions of the file, unnamed objects are kind#n by their order
+	std::string name{};
+	// A desk object (plane, stand, monitor, clock, book, ball, jewel) or a primitive (box, circle,
+	// cylinder, cone, sphere)
+	std::string kind{};
+	// Primitives only
+	PrimitiveParams primitive{};
+	SceneMaterialDescription material{};
+	glm::mat4 transform{ 1.f };
+	glm::vec4 tint{ 1.f };
+
+	// Same meshes and materials, only the transform or tint may differ
+	bool SameDefinition(const SceneObjectDescription& other) const {
+		return kind == other.kind && primitive == other.primitive && material == other.material;
+	}
+};
+
+// Text description of a scene, one object or light per line:
+//
+//     # comment
+//     point_light position=-4,5.5,-4 color=1,0.5,0.5 ambient=0.2 diffuse=0.8 specular=0.5
+//     monitor position=0,1,-0.5
+//     sphere name=globe radius=0.5 stacks=16 sectors=32 texture=glossy.jpg shininess=16 position=2,1.5,0
+//
+// position, rotate=degrees,x,y,z and scale are applied to the object's matrix in the order written.
+class SceneDescription {
+public:
+	std::vector<SceneObjectDescription> objects{};
+	DirectionalLight dirLight{};
+	std::vector<PointLight> pointLights{};
+
+	// Errors are reported with their line and leave description unchanged
+	static bool Parse(std::string_view text, SceneDescription& description, std::string& error);
+	static bool Load(const std::filesystem::path& path, SceneDescription& description);
+};
+
+struct SceneReloadStats {
+	uint32_t unchanged{};
+	// Moved or tinted in place
+	uint32_t updated{};
+	uint32_t rebuilt{};
+	uint32_t added{};
+	uint32_t removed{};
+};
+
+// Builds a scene from a description and keeps it in step with later versions of it. Objects are
+// matched by name, one with the same definition is moved or tinted in place and anything else is
+// destroyed and created again. Primitive meshes and materials are reused by their parameters, so
+// rebuilding an object seldom uploads anything.
+class SceneBuilder {
+public:
+	SceneReloadStats Apply(const SceneDescription& description, Scene& scene);
+	// Forgets the objects and the reused meshes, materials and prefabs, for after Scene::Clear
+	void Reset();
+
+private:
+	Entity create(const SceneObjectDescription& object, Scene& scene);
+	uint32_t material(const SceneMaterialDescription& description, Scene& scene);
+
+private:
+	struct LiveObject {
+		SceneObjectDescription description{};
+		Entity root{};
+	};
+	std::unordered_map<std::string, LiveObject> _objects{};
+	// Desk objects by kind as their factory first built them, later ones reuse its meshes and materials
+	std::unordered_map<std::string, ScenePrefab> _prefabs{};
+	std::map<PrimitiveParams, uint32_t> _meshes{};
+	std::vector<std::pair<SceneMaterialDescription, uint32_t>> _materials{};
+};
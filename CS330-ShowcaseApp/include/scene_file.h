@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+
+#include <bounds.h>
+#include <scene.h>
+#include <types.h>
+
+// On disk layout of a scene, little endian. Every offset counts from the start of the file, so the
+// records are read in place from wherever the file is mapped. Sections start 16 byte aligned.
+struct SceneFileSection {
+	uint64_t offset{};
+	uint64_t count{};
+};
+
+struct SceneFileHeader {
+	std::array<char, 8> magic{};
+	uint32_t version{};
+	uint32_t reserved{};
+	SceneFileSection entities{};
+	SceneFileSection meshes{};
+	SceneFileSection textures{};
+	SceneFileSection materials{};
+	SceneFileSection renderables{};
+	// Texture paths, not terminated
+	SceneFileSection strings{};
+	// Vertex and index data of every mesh as the geometry arena stores it
+	SceneFileSection geometry{};
+};
+
+// Parents come before their children
+struct SceneFileEntity {
+	glm::mat4 local{ 1.f };
+	uint32_t parent{};
+	uint32_t reserved[3]{};
+};
+
+struct SceneFileMesh {
+	uint64_t vertexOffset{};
+	uint64_t indexOffset{};
+	uint32_t vertexCount{};
+	uint32_t indexCount{};
+	uint32_t mode{};
+	uint32_t indexType{};
+	VertexFormat format{};
+	// Count of the LOD chain starting at this mesh, the levels are the meshes right after it
+	uint8_t levels{};
+	uint16_t reserved{};
+	float fullDetailPixels{};
+	BoundingBox bounds{};
+	BoundingSphere sphere{};
+};
+
+struct SceneFileTexture {
+	uint32_t pathOffset{};
+	uint32_t pathLength{};
+	uint8_t flipVertically{};
+	uint8_t generateMipmaps{};
+	uint8_t compress{};
+	uint8_t reserved{};
+};
+
+struct SceneFileMaterial {
+	glm::vec3 ambient{};
+	float shininess{};
+	glm::vec3 diffuse{};
+	uint32_t texture{};
+	glm::vec3 specular{};
+	uint32_t reserved{};
+};
+
+struct SceneFileRenderable {
+	uint32_t entity{};
+	uint32_t mesh{};
+	uint32_t material{};
+	uint32_t reserved{};
+	glm::vec4 tint{ 1.f };
+};
+
+static_assert(sizeof(SceneFileHeader) == 128, "Scene file header layout changed, bump the version");
+static_assert(sizeof(SceneFileEntity) == 80, "Scene file entity layout changed, bump the version");
+static_assert(sizeof(SceneFileMesh) == 80, "Scene file mesh layout changed, bump the version");
+static_assert(sizeof(SceneFileTexture) == 12, "Scene file texture layout changed, bump the version");
+static_assert(sizeof(SceneFileMaterial) == 48, "Scene file material layout changed, bump the version");
+static_assert(sizeof(SceneFileRenderable) == 32, "Scene file renderable layout changed, bump the version");
+
+// Binary scene snapshots. Save reads the meshes back from the geometry arena, Load maps the file and
+// uploads the geometry straight from the mapped pages. Textures are referenced by path and stream in
+// through the TextureRegistry as usual. Systems and user components are not part of the file.
+class SceneFile {
+public:
+	static constexpr std::array<char, 8> Magic{ 'C', 'S', '3', '3', 'S', 'C', 'N', '\0' };
+	static constexpr uint32_t Version = 1;
+
+	static bool Save(const Scene& scene, const std::filesystem::path& path);
+	// Adds the file's entities to the scene, existing ones stay. Returns false when the file is
+	// missing, of another version or damaged, the scene is left untouched then.
+	static bool Load(const std::filesystem::path& path, Scene& scene);
+};
@@ -1,8 +1,14 @@
 #pragma once
 #include <filesystem>
 #include <string>
-#include <GLAD/glad.h>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <file_watcher.h>
+#include <gl_handle.h>
+#include <uniform.h>
+#include <uniform_buffer.h>
 
 using Path = std::filesystem::path;
 
@@ -10,18 +16,73 @@ class Shader {
 public:
 	Shader() = default;
 	Shader(const std::string& vertexSource, const std::string& fragmentSource);
+	// Loads the linked program from the ProgramCache when it can, and watches the files for edits
 	Shader(const Path& vertexPath, const Path& fragmentPath);
 
+	// Starts recompiling once a file changed and swaps the new program in after it linked. Meanwhile,
+	// and for good if it fails, the old program stays in use. Returns true when it swapped.
+	bool Update();
+
 	void Bind();
+	GLuint Program() const { return _shaderProgram.Get(); }
+
+	// Hot path setters, a handle lookup is a single array index
+	template <typename T>
+	void Set(const Uniform<T>& uniform, const T& value) {
+		auto uniformLoc = getUniformLocation(uniform);
+
+		if (uniformLoc != -1) {
+			setUniform(uniformLoc, value);
+		}
+	}
 
 	void SetMat4(const std::string& uniformName, const glm::mat4& mat4);
 	void SetVec3(const std::string& uniformName, const glm::vec3& value);
 	void SetInt(const std::string& uniformName, const int value);
 	void SetFloat(const std::string & uniformName, const float value);
 private:
+	// A program being compiled and linked, the shaders go away with it
+	struct Build {
+		GLProgram program{};
+		GLuint vertexShader{};
+		GLuint fragmentShader{};
+		std::string vertexSource{};
+		std::string fragmentSource{};
+	};
+
 	void load(const std::string& vertexSource, const std::string& fragmentSource);
+	void use(GLProgram program);
+	// Only issues the work, drivers with parallel shader compile do it on threads of their own
+	static Build startBuild(std::string vertexSource, std::string fragmentSource);
+	// Never blocks where the driver can tell, elsewhere the status query in finishBuild waits
+	static bool isBuilt(const Build& build);
+	// Reports compile and link errors, false when the program did not link
+	static bool finishBuild(Build& build);
+	static bool readFile(const Path& path, std::string& contents);
+	void reflectUniforms();
+	void bindUniformBlocks();
 	GLint getUniformLocation(const std::string& uniformName);
+	GLint getUniformLocation(const UniformId& uniform) const {
+		// Every name the program uses was interned at link time, a handle created afterwards is not in it
+		return uniform.Index() < _locations.size() ? _locations[uniform.Index()] : -1;
+	}
+
+	void setUniform(GLint location, const glm::mat4& value);
+	void setUniform(GLint location, const glm::mat3& value);
+	void setUniform(GLint location, const glm::vec4& value);
+	void setUniform(GLint location, const glm::vec3& value);
+	void setUniform(GLint location, const float value);
+	void setUniform(GLint location, const int value);
 
 private:
-	GLuint _shaderProgram;
+	GLProgram _shaderProgram{};
+	Path _vertexPath{};
+	Path _fragmentPath{};
+	FileWatcher _vertexWatcher{};
+	FileWatcher _fragmentWatcher{};
+	Build _pending{};
+	// Every active uniform reflected once after linking
+	std::unordered_map<std::string, GLint> _reflectedLocations{};
+	// Indexed by UniformId, filled from the reflected table
+	std::vector<GLint> _locations{};
 };
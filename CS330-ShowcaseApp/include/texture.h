@@ -1,13 +1,91 @@
 #pragma once
+#include <cstdint>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <texture_array.h>
+
+struct TextureParams {
+	bool flipVertically{ true };
+	bool generateMipmaps{ true };
+	// Cook to BC1/BC3 when the GPU supports S3TC
+	bool compress{ true };
+
+	auto operator<=>(const TextureParams&) const = default;
+};
+
+// Owns one layer of a texture array, the layer is released with the last shared handle
 class Texture {
+	friend class TextureLoader;
 public:
-	Texture(const std::filesystem::path& path);
+	// Decodes and uploads synchronously, TextureRegistry::Load streams textures in the background instead
+	Texture(const std::filesystem::path& path, const TextureParams& params = {});
+	~Texture();
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// Binds the array holding the texture, or the placeholder's until the texture is ready
 	void Bind();
 
+	// Array and layer to sample, they point at the placeholder until the texture is ready
+	GLuint Handle() const;
+	uint32_t Layer() const { return _ready ? _layer : _placeholder->Layer(); }
+	// Offset and scale of the texture within its layer. Cooking resamples images to fill their
+	// layer, so for now this is always the full rect.
+	glm::vec4 UvRect() const { return _ready ? _uvRect : _placeholder->UvRect(); }
+	bool IsReady() const { return _ready; }
+	// True when any texel is not fully opaque, such materials are drawn after the opaque ones
+	bool IsTranslucent() const { return _ready ? _isTranslucent : _placeholder->IsTranslucent(); }
+	// GPU memory held by the texture's layer including its mip chain
+	uint64_t SizeBytes() const { return _array ? _array->LayerBytes() : 0; }
+	// What the texture was loaded from, empty for the placeholder
+	const std::filesystem::path& Path() const { return _path; }
+	const TextureParams& Params() const { return _params; }
+
 	static const std::filesystem::path texturePath;
 private:
-	GLuint _textureHandle;
-};
\ No newline at end of file
+	Texture(std::shared_ptr<Texture> placeholder);
+	static std::shared_ptr<Texture> CreatePending(std::shared_ptr<Texture> placeholder);
+	// Takes over a layer the loader filled, an empty array marks a texture that failed to load
+	void markReady(bool isTranslucent, std::shared_ptr<TextureArray> array, uint32_t layer);
+
+private:
+	std::shared_ptr<TextureArray> _array{};
+	uint32_t _layer{};
+	glm::vec4 _uvRect{ 0.f, 0.f, 1.f, 1.f };
+	bool _isTranslucent{ false };
+	bool _ready{ true };
+	std::shared_ptr<Texture> _placeholder{};
+	std::filesystem::path _path{};
+	TextureParams _params{};
+};
+
+// Hands out shared textures keyed by canonical path and load parameters, so an image used by
+// several materials is decoded and uploaded once. Entries are weak, the registry never keeps a texture alive.
+// New textures are streamed in by the TextureLoader.
+class TextureRegistry {
+public:
+	static TextureRegistry& Get();
+
+	std::shared_ptr<Texture> Load(const std::filesystem::path& path, const TextureParams& params = {});
+
+	// Sum over the textures still alive
+	uint64_t ResidentBytes() const;
+	size_t ResidentCount() const;
+
+private:
+	TextureRegistry() = default;
+
+	struct Key {
+		std::string path;
+		TextureParams params;
+
+		auto operator<=>(const Key&) const = default;
+	};
+
+	std::map<Key, std::weak_ptr<Texture>> _textures{};
+};
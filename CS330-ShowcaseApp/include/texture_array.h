@@ -0,0 +1,66 @@
+#pragma once
+#include <compare>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include <gl_handle.h>
+
+// From EXT_texture_compression_s3tc, which GLAD was generated without
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+struct TextureArrayFormat {
+	// GL_RGBA8 or one of the S3TC formats
+	GLenum format;
+	int width;
+	int height;
+	int levels;
+
+	auto operator<=>(const TextureArrayFormat&) const = default;
+};
+
+// GL_TEXTURE_2D_ARRAY holding every texture of one size and format as a layer, so materials using
+// any of them share texture state. Capacity doubles when full, the existing layers are copied over on
+// the GPU through a pixel pack buffer.
+class TextureArray {
+public:
+	// Shared array for the format, created on first use and deleted with its last texture
+	static std::shared_ptr<TextureArray> Acquire(const TextureArrayFormat& format);
+	// GPU memory allocated by all live arrays, including layers not in use
+	static uint64_t AllocatedBytes();
+
+	~TextureArray();
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	// Must not be called while a pixel unpack buffer is bound, growing the array allocates new storage
+	uint32_t AllocateLayer();
+	void FreeLayer(uint32_t layer);
+	// Pixels is an offset into the pixel unpack buffer when one is bound
+	void UploadLevel(uint32_t layer, int level, const void* pixels, GLsizei imageSize);
+
+	void Bind();
+	GLuint Handle() const { return _handle.Get(); }
+	const TextureArrayFormat& Format() const { return _format; }
+	uint64_t LayerBytes() const;
+
+private:
+	explicit TextureArray(const TextureArrayFormat& format);
+
+	bool isCompressed() const { return _format.format != GL_RGBA8; }
+	size_t levelBytes(int level) const;
+	GLTexture createStorage(uint32_t layers);
+	void grow();
+
+private:
+	TextureArrayFormat _format;
+	GLTexture _handle{};
+	uint32_t _capacity{};
+	uint32_t _used{};
+	std::vector<uint32_t> _freeLayers{};
+};
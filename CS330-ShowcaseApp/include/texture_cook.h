@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+
+#include <mapped_file.h>
+#include <texture.h>
+
+struct TextureLevel {
+	int width;
+	int height;
+	std::span<const uint8_t> data;
+};
+
+// Mip chain ready for upload, largest level first. The levels point into storage or into a mapped cache file.
+struct TextureData {
+	// GL_RGBA8 or one of the S3TC formats
+	GLenum format{ GL_RGBA8 };
+	bool translucent{ false };
+	std::vector<TextureLevel> levels{};
+	std::vector<uint8_t> storage{};
+	MappedFile mapping{};
+
+	bool IsCompressed() const { return format != GL_RGBA8; }
+	uint64_t SizeBytes() const;
+};
+
+// Turns source images into upload ready mip chains. Cooked textures are BC1, or BC3 when any texel is
+// translucent, and are kept in cache/textures in files named after a hash of the source bytes and load
+// parameters. A cache hit maps the file and skips the PNG/JPEG decode entirely.
+class TextureCook {
+public:
+	// Decodes to RGBA8 resampled to the closest power of two size, with a box filtered mip chain like glGenerateMipmap
+	static std::optional<TextureData> Decode(std::span<const uint8_t> source, const TextureParams& params);
+	// Maps the cooked texture for the source, cooking it first on a miss
+	static std::optional<TextureData> LoadCooked(std::span<const uint8_t> source, const TextureParams& params);
+	// Cooks every image in the directory ahead of time, returns how many were written
+	static size_t CookDirectory(const std::filesystem::path& directory, const TextureParams& params = {});
+
+	static bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& contents);
+
+	static const std::filesystem::path cachePath;
+
+private:
+	static uint64_t hash(std::span<const uint8_t> source, const TextureParams& params);
+	static std::filesystem::path cachedFile(uint64_t key);
+	static std::optional<TextureData> mapCooked(uint64_t key);
+	static std::optional<TextureData> cook(std::span<const uint8_t> source, const TextureParams& params, uint64_t key);
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+
+#include <gl_handle.h>
+#include <texture.h>
+#include <texture_cook.h>
+
+// Decodes or maps cooked textures on worker threads, then streams the levels to the GPU through a
+// pixel unpack buffer from the render thread. Textures draw with debug.png until their last level is in.
+class TextureLoader {
+public:
+	static TextureLoader& Get();
+
+	// Returns right away with a texture that is not ready yet
+	std::shared_ptr<Texture> Load(const std::filesystem::path& path, const TextureParams& params = {});
+
+	// Render thread, once per frame. Uploads at least one mip level and stops once the budget is spent.
+	void Update(size_t budgetBytes = defaultUploadBudget);
+	// Blocks until every queued texture is decoded and uploaded
+	void Finish();
+	bool IsIdle();
+
+	// Joins the workers and releases the GL objects, must run while the context is still current
+	void Shutdown();
+
+	static constexpr size_t defaultUploadBudget = 8 << 20;
+
+private:
+	TextureLoader();
+	~TextureLoader();
+
+	struct Job {
+		std::weak_ptr<Texture> texture;
+		std::filesystem::path path;
+		TextureParams params;
+		TextureData data{};
+		std::shared_ptr<TextureArray> array{};
+		uint32_t layer{};
+		size_t nextLevel{ 0 };
+	};
+
+	void startWorkers();
+	void stopWorkers();
+	void workerLoop();
+	static void decode(Job& job);
+	size_t uploadLevel(Job& job);
+
+private:
+	std::vector<std::thread> _workers{};
+	std::mutex _mutex{};
+	std::condition_variable _jobAvailable{};
+	std::condition_variable _jobDecoded{};
+	std::deque<Job> _queued{};
+	std::deque<Job> _decoded{};
+	size_t _decoding{ 0 };
+	bool _stopping{ false };
+
+	// Only touched on the render thread
+	std::optional<Job> _uploading{};
+	std::shared_ptr<Texture> _placeholder{};
+	GLBuffer _unpackBuffer{};
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Local and world matrices of every node in one array, parents always before their children.
+// SetLocal only flags the node, Update then walks the array from the first flagged node and
+// multiplies the nodes that changed and everything below them. A frame without changes costs
+// nothing. Large updates are split over the job system one depth at a time.
+class TransformHierarchy {
+public:
+	static constexpr uint32_t None = UINT32_MAX;
+
+	// The parent has to exist already, which is what keeps parents before children
+	uint32_t Add(const glm::mat4& local, uint32_t parent = None);
+	// Safe from several jobs at once as long as each node is set by one of them
+	void SetLocal(uint32_t node, const glm::mat4& local);
+	// Removes a whole subtree, the nodes after it move down by count
+	void Erase(uint32_t first, uint32_t count);
+	void Clear();
+
+	const glm::mat4& Local(uint32_t node) const { return _local[node]; }
+	// Valid after Update
+	const glm::mat4& World(uint32_t node) const { return _world[node]; }
+
+	// Returns the number of world matrices recomputed and appends their nodes to changed when given
+	uint32_t Update(std::vector<uint32_t>* changed = nullptr);
+	uint32_t Parent(uint32_t node) const { return _parents[node]; }
+
+	size_t Size() const { return _local.size(); }
+
+private:
+	void markDirty(uint32_t node);
+	void rebuildLevels();
+	void updateNode(size_t node);
+
+private:
+	std::vector<uint32_t> _parents{};
+	std::vector<glm::mat4> _local{};
+	std::vector<glm::mat4> _world{};
+	// Set by SetLocal, and by Update for every node it recomputed so the children follow
+	std::vector<uint8_t> _dirty{};
+	std::vector<uint32_t> _depths{};
+	// Node indices of each depth in ascending order. Add appends to them, Erase leaves them for the
+	// next parallel Update to rebuild.
+	std::vector<std::vector<uint32_t>> _levels{};
+	bool _levelsStale{};
+	std::atomic<size_t> _firstDirty{ SIZE_MAX };
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <glm/ext/vector_uint4_sized.hpp>
 
 struct Vertex {
     glm::vec3 Position {0.f, 0.f, 0.f};
@@ -7,3 +9,42 @@ struct Vertex {
     glm::vec3 Normal {0.f, 0.f, 0.f};
     glm::vec2 Uv {1.f, 1.f};
 };
+
+// Layout a mesh is stored in on the GPU, meshes are always built as Vertex and packed on upload
+enum class VertexFormat : uint8_t {
+    // Vertex as it is, 48 bytes
+    Float,
+    // Float position, GL_INT_2_10_10_10_REV normal, RGBA8 color and half float UV, 24 bytes
+    Packed,
+    // Packed with a half float position, 20 bytes. Only for small meshes close to their origin.
+    PackedHalf,
+};
+
+struct PackedVertex {
+    glm::vec3 Position {0.f, 0.f, 0.f};
+    uint32_t Normal {0};
+    uint32_t Color {0};
+    uint32_t Uv {0};
+};
+
+struct PackedHalfVertex {
+    // w is padding to keep the normal aligned
+    glm::u16vec4 Position {0, 0, 0, 0};
+    uint32_t Normal {0};
+    uint32_t Color {0};
+    uint32_t Uv {0};
+};
+
+static_assert(sizeof(PackedVertex) == 24);
+static_assert(sizeof(PackedHalfVertex) == 20);
+
+// Per-instance vertex attributes, streamed by the render queue every frame
+struct InstanceData {
+    // Rows of the affine model matrix, its last row is always 0 0 0 1 and is not sent
+    glm::mat3x4 ModelRows {1.f};
+    // Inverse transpose of the upper 3x3, or the 3x3 itself for rigid and uniformly scaled transforms
+    glm::mat3 NormalMatrix {1.f};
+    glm::vec4 Tint {1.f, 1.f, 1.f, 1.f};
+    // Into the Materials uniform block, assigned by the render queue each frame
+    uint32_t MaterialIndex {0};
+};
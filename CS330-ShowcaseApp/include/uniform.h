@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Uniform names are interned once into dense ids so that every shader can resolve them
+// into a flat location table at link time. Create handles once (e.g. as statics) and reuse them.
+class UniformId {
+public:
+	explicit UniformId(const std::string& name);
+
+	uint32_t Index() const { return _index; }
+	const std::string& Name() const;
+
+	static uint32_t Count();
+
+private:
+	uint32_t _index;
+};
+
+// Typed handle, Shader::Set only accepts values of the matching type
+template <typename T>
+class Uniform : public UniformId {
+public:
+	explicit Uniform(const std::string& name) : UniformId(name) {}
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <gl_handle.h>
+
+// Fixed binding points for the uniform blocks shared by every shader.
+// Shader binds blocks with these names to their binding point after linking.
+enum class UniformBlock : GLuint {
+	Camera = 0,
+	Lights = 1,
+	Materials = 2,
+	Count
+};
+
+inline const char* UniformBlockName(UniformBlock block) {
+	switch (block) {
+	case UniformBlock::Camera: return "Camera";
+	case UniformBlock::Lights: return "Lights";
+	case UniformBlock::Materials: return "Materials";
+	default: return "";
+	}
+}
+
+// std140 layout of the Camera block in lighting.vs/lighting.fs
+struct CameraBlock {
+	glm::mat4 view{ 1.f };
+	glm::mat4 projection{ 1.f };
+	glm::vec3 viewPos{};
+	float _padding{};
+};
+
+// GPU buffer backing one uniform block, written with a single upload per update
+template <typename T>
+class UniformBuffer {
+public:
+	UniformBuffer() = default;
+	UniformBuffer(UniformBlock block) : _binding{ static_cast<GLuint>(block) } {
+		_buffer = GLBuffer::Create();
+		glBindBuffer(GL_UNIFORM_BUFFER, _buffer.Get());
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, _binding, _buffer.Get());
+	}
+
+	void Update(const T& data) {
+		Update(data, sizeof(T));
+	}
+
+	// Uploads only the first size bytes, for blocks ending in a mostly unused array
+	void Update(const T& data, size_t size) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _buffer.Get());
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), &data);
+	}
+
+	bool IsValid() const { return static_cast<bool>(_buffer); }
+	void Release() { _buffer.Reset(); }
+
+private:
+	GLBuffer _buffer{};
+	GLuint _binding{};
+};
@@ -0,0 +1,693 @@
+#include <aabb_tree.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <job_system.h>
+
+// Leaves are stored this much larger on every side
+static constexpr float fatMargin = 0.1f;
+// Auto switches from reinserting to refitting once this share of the leaves moved in one update
+static constexpr float refitShare = 0.25f;
+// and rebuilds once refits have made the tree this much more expensive to traverse
+static constexpr float rebuildCostRatio = 1.5f;
+// Frustum queries over fewer leaves walk the tree on the calling thread
+static constexpr size_t parallelQueryLeaves = 8192;
+
+BoundingBox AabbTree::fatten(const BoundingBox& box) const
+{
+	return { .min = box.min - glm::vec3{ fatMargin }, .max = box.max + glm::vec3{ fatMargin } };
+}
+
+int32_t AabbTree::allocateNode()
+{
+	if (_freeList == Null) {
+		_nodes.emplace_back();
+		return static_cast<int32_t>(_nodes.size() - 1);
+	}
+
+	// Free nodes chain through their parent index
+	auto node = _freeList;
+	_freeList = _nodes[node].parent;
+	_nodes[node] = {};
+	return node;
+}
+
+void AabbTree::freeNode(int32_t node)
+{
+	_nodes[node].parent = _freeList;
+	_nodes[node].height = -1;
+	_freeList = node;
+}
+
+int32_t AabbTree::Insert(const BoundingBox& box, uint32_t userData)
+{
+	auto leaf = allocateNode();
+	auto& node = _nodes[leaf];
+	node.box = fatten(box);
+	node.tight = box;
+	node.height = 0;
+	node.userData = userData;
+
+	insertLeaf(leaf);
+	_leafCount++;
+	return leaf;
+}
+
+void AabbTree::Remove(int32_t proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+	_leafCount--;
+}
+
+bool AabbTree::Move(int32_t proxy, const BoundingBox& box)
+{
+	_nodes[proxy].tight = box;
+	if (_nodes[proxy].box.Contains(box)) {
+		return false;
+	}
+
+	removeLeaf(proxy);
+	_nodes[proxy].box = fatten(box);
+	insertLeaf(proxy);
+	return true;
+}
+
+void AabbTree::Refit(int32_t proxy, const BoundingBox& box)
+{
+	auto& node = _nodes[proxy];
+	node.tight = box;
+	if (node.box.Contains(box)) {
+		return;
+	}
+
+	node.box = fatten(box);
+	refitAncestors(node.parent);
+}
+
+void AabbTree::insertLeaf(int32_t leaf)
+{
+	if (_root == Null) {
+		_root = leaf;
+		_nodes[leaf].parent = Null;
+		return;
+	}
+
+	// Walk down towards the sibling that grows the total surface area the least
+	auto leafBox = _nodes[leaf].box;
+	auto index = _root;
+	while (!_nodes[index].IsLeaf()) {
+		auto& node = _nodes[index];
+		float area = node.box.SurfaceArea();
+		float combinedArea = node.box.Merged(leafBox).SurfaceArea();
+
+		// Cost of making a new parent for this node and the leaf, and the minimum any descent adds on top
+		float cost = 2.f * combinedArea;
+		float inheritance = 2.f * (combinedArea - area);
+
+		auto descendCost = [&](int32_t child) {
+			auto& childBox = _nodes[child].box;
+			float merged = childBox.Merged(leafBox).SurfaceArea();
+			return (_nodes[child].IsLeaf() ? merged : merged - childBox.SurfaceArea()) + inheritance;
+		};
+		float leftCost = descendCost(node.left);
+		float rightCost = descendCost(node.right);
+
+		if (cost < leftCost && cost < rightCost) {
+			break;
+		}
+		index = leftCost < rightCost ? node.left : node.right;
+	}
+
+	auto sibling = index;
+	auto oldParent = _nodes[sibling].parent;
+	auto newParent = allocateNode();
+
+	auto& parent = _nodes[newParent];
+	parent.parent = oldParent;
+	parent.box = leafBox.Merged(_nodes[sibling].box);
+	parent.height = _nodes[sibling].height + 1;
+	parent.left = sibling;
+	parent.right = leaf;
+
+	if (oldParent == Null) {
+		_root = newParent;
+	}
+	else if (_nodes[oldParent].left == sibling) {
+		_nodes[oldParent].left = newParent;
+	}
+	else {
+		_nodes[oldParent].right = newParent;
+	}
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+
+	// Fix up heights and boxes on the way back to the root
+	index = newParent;
+	while (index != Null) {
+		index = balance(index);
+
+		auto& node = _nodes[index];
+		node.height = 1 + std::max(_nodes[node.left].height, _nodes[node.right].height);
+		node.box = _nodes[node.left].box.Merged(_nodes[node.right].box);
+		index = node.parent;
+	}
+}
+
+void AabbTree::removeLeaf(int32_t leaf)
+{
+	if (leaf == _root) {
+		_root = Null;
+		return;
+	}
+
+	auto parent = _nodes[leaf].parent;
+	auto grandParent = _nodes[parent].parent;
+	auto sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+	freeNode(parent);
+
+	if (grandParent == Null) {
+		_root = sibling;
+		_nodes[sibling].parent = Null;
+		return;
+	}
+
+	// The sibling takes the place of the parent
+	if (_nodes[grandParent].left == parent) {
+		_nodes[grandParent].left = sibling;
+	}
+	else {
+		_nodes[grandParent].right = sibling;
+	}
+	_nodes[sibling].parent = grandParent;
+
+	auto index = grandParent;
+	while (index != Null) {
+		index = balance(index);
+
+		auto& node = _nodes[index];
+		node.height = 1 + std::max(_nodes[node.left].height, _nodes[node.right].height);
+		node.box = _nodes[node.left].box.Merged(_nodes[node.right].box);
+		index = node.parent;
+	}
+}
+
+int32_t AabbTree::balance(int32_t indexA)
+{
+	// Rotates the taller grandchild up when the children of A differ in height by more than one
+	auto& a = _nodes[indexA];
+	if (a.IsLeaf() || a.height < 2) {
+		return indexA;
+	}
+
+	auto indexB = a.left;
+	auto indexC = a.right;
+	auto& b = _nodes[indexB];
+	auto& c = _nodes[indexC];
+
+	auto replaceChild = [&](int32_t parent, int32_t oldChild, int32_t newChild) {
+		if (parent == Null) {
+			_root = newChild;
+		}
+		else if (_nodes[parent].left == oldChild) {
+			_nodes[parent].left = newChild;
+		}
+		else {
+			_nodes[parent].right = newChild;
+		}
+	};
+
+	int32_t balance = c.height - b.height;
+
+	// Rotate C up
+	if (balance > 1) {
+		auto indexF = c.left;
+		auto indexG = c.right;
+		auto& f = _nodes[indexF];
+		auto& g = _nodes[indexG];
+
+		c.left = indexA;
+		c.parent = a.parent;
+		a.parent = indexC;
+		replaceChild(c.parent, indexA, indexC);
+
+		if (f.height > g.height) {
+			c.right = indexF;
+			a.right = indexG;
+			g.parent = indexA;
+			a.box = b.box.Merged(g.box);
+			c.box = a.box.Merged(f.box);
+			a.height = 1 + std::max(b.height, g.height);
+			c.height = 1 + std::max(a.height, f.height);
+		}
+		else {
+			c.right = indexG;
+			a.right = indexF;
+			f.parent = indexA;
+			a.box = b.box.Merged(f.box);
+			c.box = a.box.Merged(g.box);
+			a.height = 1 + std::max(b.height, f.height);
+			c.height = 1 + std::max(a.height, g.height);
+		}
+
+		return indexC;
+	}
+
+	// Rotate B up
+	if (balance < -1) {
+		auto indexD = b.left;
+		auto indexE = b.right;
+		auto& d = _nodes[indexD];
+		auto& e = _nodes[indexE];
+
+		b.left = indexA;
+		b.parent = a.parent;
+		a.parent = indexB;
+		replaceChild(b.parent, indexA, indexB);
+
+		if (d.height > e.height) {
+			b.right = indexD;
+			a.left = indexE;
+			e.parent = indexA;
+			a.box = c.box.Merged(e.box);
+			b.box = a.box.Merged(d.box);
+			a.height = 1 + std::max(c.height, e.height);
+			b.height = 1 + std::max(a.height, d.height);
+		}
+		else {
+			b.right = indexE;
+			a.left = indexD;
+			d.parent = indexA;
+			a.box = c.box.Merged(d.box);
+			b.box = a.box.Merged(e.box);
+			a.height = 1 + std::max(c.height, d.height);
+			b.height = 1 + std::max(a.height, e.height);
+		}
+
+		return indexB;
+	}
+
+	return indexA;
+}
+
+void AabbTree::refitAncestors(int32_t node)
+{
+	while (node != Null) {
+		auto& current = _nodes[node];
+		auto box = _nodes[current.left].box.Merged(_nodes[current.right].box);
+		if (box.min == current.box.min && box.max == current.box.max) {
+			return;
+		}
+
+		current.box = box;
+		node = current.parent;
+	}
+}
+
+void AabbTree::refitAll(int32_t node)
+{
+	auto& current = _nodes[node];
+	if (current.IsLeaf()) {
+		return;
+	}
+
+	refitAll(current.left);
+	refitAll(current.right);
+	_nodes[node].box = _nodes[_nodes[node].left].box.Merged(_nodes[_nodes[node].right].box);
+}
+
+void AabbTree::Rebuild()
+{
+	std::vector<int32_t> leaves{};
+	leaves.reserve(_leafCount);
+
+	for (int32_t node = 0; node < static_cast<int32_t>(_nodes.size()); node++) {
+		if (_nodes[node].height == 0) {
+			leaves.push_back(node);
+		}
+		else if (_nodes[node].height > 0) {
+			freeNode(node);
+		}
+	}
+
+	_root = leaves.empty() ? Null : build(leaves);
+	if (_root != Null) {
+		_nodes[_root].parent = Null;
+	}
+	_builtCost = Cost();
+	_stats.rebuilds++;
+}
+
+int32_t AabbTree::build(std::span<int32_t> leaves)
+{
+	if (leaves.size() == 1) {
+		return leaves[0];
+	}
+
+	BoundingBox centroids{ .min = glm::vec3{ FLT_MAX }, .max = glm::vec3{ -FLT_MAX } };
+	for (auto leaf : leaves) {
+		auto center = _nodes[leaf].box.Center();
+		centroids.min = glm::min(centroids.min, center);
+		centroids.max = glm::max(centroids.max, center);
+	}
+
+	auto size = centroids.max - centroids.min;
+	int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	size_t split = leaves.size() / 2;
+
+	if (size[axis] > 0.f) {
+		// Bin the centroids along the longest axis and split where the surface area heuristic is lowest
+		constexpr int binCount = 12;
+		struct Bin {
+			BoundingBox box{ .min = glm::vec3{ FLT_MAX }, .max = glm::vec3{ -FLT_MAX } };
+			uint32_t count{};
+		};
+		std::array<Bin, binCount> bins{};
+
+		auto binOf = [&](int32_t leaf) {
+			float offset = (_nodes[leaf].box.Center()[axis] - centroids.min[axis]) / size[axis];
+			return std::min(static_cast<int>(offset * binCount), binCount - 1);
+		};
+		for (auto leaf : leaves) {
+			auto& bin = bins[binOf(leaf)];
+			bin.box = bin.box.Merged(_nodes[leaf].box);
+			bin.count++;
+		}
+
+		std::array<float, binCount - 1> rightCosts{};
+		Bin right{};
+		for (int i = binCount - 1; i > 0; i--) {
+			right.box = right.box.Merged(bins[i].box);
+			right.count += bins[i].count;
+			rightCosts[i - 1] = right.count ? right.count * right.box.SurfaceArea() : 0.f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestBin = -1;
+		Bin left{};
+		for (int i = 0; i < binCount - 1; i++) {
+			left.box = left.box.Merged(bins[i].box);
+			left.count += bins[i].count;
+			if (left.count == 0 || left.count == leaves.size()) {
+				continue;
+			}
+
+			float cost = left.count * left.box.SurfaceArea() + rightCosts[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if (bestBin >= 0) {
+			auto middle = std::partition(leaves.begin(), leaves.end(), [&](int32_t leaf) { return binOf(leaf) <= bestBin; });
+			split = static_cast<size_t>(middle - leaves.begin());
+		}
+	}
+
+	// Identical centroids or a failed split fall back to a median split, which keeps the depth logarithmic
+	if (split == 0 || split == leaves.size() || size[axis] <= 0.f) {
+		split = leaves.size() / 2;
+		std::nth_element(leaves.begin(), leaves.begin() + split, leaves.end(), [&](int32_t a, int32_t b) {
+			return _nodes[a].box.Center()[axis] < _nodes[b].box.Center()[axis];
+		});
+	}
+
+	auto leftChild = build(leaves.first(split));
+	auto rightChild = build(leaves.subspan(split));
+
+	auto index = allocateNode();
+	auto& node = _nodes[index];
+	node.left = leftChild;
+	node.right = rightChild;
+	node.box = _nodes[leftChild].box.Merged(_nodes[rightChild].box);
+	node.height = 1 + std::max(_nodes[leftChild].height, _nodes[rightChild].height);
+	_nodes[leftChild].parent = index;
+	_nodes[rightChild].parent = index;
+
+	return index;
+}
+
+void AabbTree::Update(std::span<const AabbTreeUpdate> updates, AabbTreeUpdatePolicy policy)
+{
+	_stats = {};
+	if (updates.empty()) {
+		return;
+	}
+
+	if (policy == AabbTreeUpdatePolicy::Auto) {
+		policy = updates.size() < refitShare * _leafCount ? AabbTreeUpdatePolicy::Reinsert : AabbTreeUpdatePolicy::Refit;
+	}
+
+	if (policy == AabbTreeUpdatePolicy::Reinsert) {
+		for (auto& update : updates) {
+			_stats.reinserted += Move(update.proxy, update.box) ? 1 : 0;
+		}
+		return;
+	}
+
+	// Trees built by inserts alone get their baseline the first time they are refit
+	if (_builtCost == 0.f) {
+		_builtCost = Cost();
+	}
+
+	// Refits and rebuilds only touch the leaves here and fix the internal nodes in one pass afterwards
+	for (auto& update : updates) {
+		auto& leaf = _nodes[update.proxy];
+		leaf.tight = update.box;
+		if (!leaf.box.Contains(update.box)) {
+			leaf.box = fatten(update.box);
+			_stats.refit++;
+		}
+	}
+
+	if (policy == AabbTreeUpdatePolicy::Rebuild) {
+		Rebuild();
+		return;
+	}
+
+	if (_stats.refit > 0 && _root != Null) {
+		refitAll(_root);
+	}
+	if (_builtCost > 0.f && Cost() > rebuildCostRatio * _builtCost) {
+		Rebuild();
+	}
+}
+
+float AabbTree::Cost() const
+{
+	if (_root == Null || _nodes[_root].IsLeaf()) {
+		return 0.f;
+	}
+
+	float area = 0.f;
+	for (auto& node : _nodes) {
+		if (node.height > 0) {
+			area += node.box.SurfaceArea();
+		}
+	}
+
+	return area / std::max(_nodes[_root].box.SurfaceArea(), FLT_MIN);
+}
+
+void AabbTree::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& results) const
+{
+	if (_root == Null) {
+		return;
+	}
+
+	// Never more results than leaves, so the caller's vector stops growing with the tree
+	results.reserve(results.size() + _leafCount);
+
+	auto& jobs = JobSystem::Get();
+	if (_leafCount < parallelQueryLeaves || jobs.ThreadCount() == 1) {
+		queryFrustum(frustum, _root, results);
+		return;
+	}
+
+	// Splits the top of the tree into a few subtrees per thread and walks them in parallel. Each round
+	// splits every internal node in place, right child first as the serial walk pops it first, so the
+	// list stays in the order the serial walk reaches the subtrees.
+	_querySubtrees.clear();
+	_querySubtrees.push_back(_root);
+	size_t target = jobs.ThreadCount() * 4;
+	for (bool split = true; split && _querySubtrees.size() < target;) {
+		split = false;
+		for (size_t i = 0; i < _querySubtrees.size() && _querySubtrees.size() < target; i++) {
+			auto& node = _nodes[_querySubtrees[i]];
+			if (node.IsLeaf()) {
+				continue;
+			}
+			auto left = node.left;
+			_querySubtrees[i] = node.right;
+			_querySubtrees.insert(_querySubtrees.begin() + ++i, left);
+			split = true;
+		}
+	}
+
+	// Each subtree is walked into a per thread buffer and copied into one shared by all, at most a
+	// leaf each. Concatenating in subtree order keeps the results in the serial order.
+	if (_queryResults.size() < _leafCount) {
+		_queryResults.resize(_leafCount);
+	}
+	_querySpans.resize(_querySubtrees.size());
+	std::atomic<size_t> used{};
+	jobs.ParallelFor(_querySubtrees.size(), 1, [&](size_t begin, size_t end) {
+		static thread_local std::vector<uint32_t> found{};
+		for (size_t i = begin; i < end; i++) {
+			found.clear();
+			found.reserve(_leafCount);
+			queryFrustum(frustum, _querySubtrees[i], found);
+
+			auto offset = used.fetch_add(found.size());
+			std::copy(found.begin(), found.end(), _queryResults.begin() + offset);
+			_querySpans[i] = { offset, found.size() };
+		}
+	});
+
+	for (auto [offset, count] : _querySpans) {
+		results.insert(results.end(), _queryResults.begin() + offset, _queryResults.begin() + offset + count);
+	}
+}
+
+void AabbTree::queryFrustum(const Frustum& frustum, int32_t root, std::vector<uint32_t>& results) const
+{
+	// Kept per thread so queries stop allocating once the stacks are deep enough. Queries do not
+	// nest, so each thread only ever runs one at a time. Neither stack gets deeper than the tree.
+	static thread_local std::vector<int32_t> stack{};
+	static thread_local std::vector<int32_t> inside{};
+	stack.clear();
+	stack.reserve(Height() + 1);
+	inside.clear();
+	inside.reserve(Height() + 1);
+
+	stack.push_back(root);
+	while (!stack.empty()) {
+		auto index = stack.back();
+		stack.pop_back();
+		auto& node = _nodes[index];
+
+		auto containment = frustum.Classify(node.IsLeaf() ? node.tight : node.box);
+		if (containment == Containment::Outside) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			results.push_back(node.userData);
+			continue;
+		}
+
+		// Everything below a node fully inside is visible, collect it without further plane tests
+		if (containment == Containment::Inside) {
+			inside.push_back(index);
+			while (!inside.empty()) {
+				auto& child = _nodes[inside.back()];
+				inside.pop_back();
+				if (child.IsLeaf()) {
+					results.push_back(child.userData);
+				}
+				else {
+					inside.push_back(child.left);
+					inside.push_back(child.right);
+				}
+			}
+			continue;
+		}
+
+		stack.push_back(node.left);
+		stack.push_back(node.right);
+	}
+}
+
+void AabbTree::QueryOverlap(const BoundingBox& box, std::vector<uint32_t>& results) const
+{
+	if (_root == Null) {
+		return;
+	}
+
+	std::vector<int32_t> stack{};
+	stack.reserve(Height() + 1);
+
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		auto& node = _nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.box.Overlaps(box)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			if (node.tight.Overlaps(box)) {
+				results.push_back(node.userData);
+			}
+			continue;
+		}
+
+		stack.push_back(node.left);
+		stack.push_back(node.right);
+	}
+}
+
+// Slab test, distance is where the ray enters the box or 0 when it starts inside
+static bool rayEnters(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance)
+{
+	glm::vec3 t0 = (box.min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.max - origin) * inverseDirection;
+	glm::vec3 nearest = glm::min(t0, t1);
+	glm::vec3 farthest = glm::max(t0, t1);
+
+	float enter = std::max({ nearest.x, nearest.y, nearest.z, 0.f });
+	float exit = std::min({ farthest.x, farthest.y, farthest.z, maxDistance });
+	distance = enter;
+	return enter <= exit;
+}
+
+std::optional<RayHit> AabbTree::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+	if (_root == Null) {
+		return std::nullopt;
+	}
+
+	glm::vec3 inverseDirection = 1.f / direction;
+	std::optional<RayHit> closest{};
+	float distance;
+
+	std::vector<int32_t> stack{};
+	stack.reserve(Height() + 1);
+
+	stack.push_back(_root);
+	while (!stack.empty()) {
+		auto& node = _nodes[stack.back()];
+		stack.pop_back();
+
+		// Hits found so far shorten the ray, which prunes everything behind them
+		if (!rayEnters(node.box, origin, inverseDirection, maxDistance, distance)) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			if (rayEnters(node.tight, origin, inverseDirection, maxDistance, distance)) {
+				closest = RayHit{ .userData = node.userData, .distance = distance };
+				maxDistance = distance;
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so its hits can prune the farther one
+		float leftDistance = FLT_MAX, rightDistance = FLT_MAX;
+		bool left = rayEnters(_nodes[node.left].box, origin, inverseDirection, maxDistance, leftDistance);
+		bool right = rayEnters(_nodes[node.right].box, origin, inverseDirection, maxDistance, rightDistance);
+		if (left && right) {
+			bool leftFirst = leftDistance <= rightDistance;
+			stack.push_back(leftFirst ? node.right : node.left);
+			stack.push_back(leftFirst ? node.left : node.right);
+		}
+		else if (left) {
+			stack.push_back(node.left);
+		}
+		else if (right) {
+			stack.push_back(node.right);
+		}
+	}
+
+	return closest;
+}
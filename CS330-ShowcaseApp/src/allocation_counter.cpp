@@ -0,0 +1,44 @@
+#include <allocation_counter.h>
+#include <cstdlib>
+#include <new>
+
+void* countedAllocate(size_t size)
+{
+	AllocationCounter::_allocations.fetch_add(1, std::memory_order_relaxed);
+	AllocationCounter::_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (auto memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc{};
+}
+
+void* operator new(size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
@@ -1,6 +1,16 @@
 #include <application.h>
+#include <geometry_arena.h>
+#include <geometry_cache.h>
+#include <gl_capabilities.h>
+#include <gl_handle.h>
+#include <job_system.h>
+#include <scene_description.h>
+#include <scene_file.h>
 #include <types.h>
 #include <shader.h>
+#include <texture_loader.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
@@ -16,77 +26,19 @@ Application::Application(
 	_cameraAngleSpeed{ 0.15f, 0.15f }
 {}
 
-void Application::Run() {
-	// Open the window
-	if (!openWindow()) {
-		return;
-	}
-
-	setupInputs();
-
-	_running = true;
-
-	// Arrange the elements in the window
-	setupScene();
-
-	// Run app
-	while (_running){
-		double currentTime = glfwGetTime();
-
-		if (_lastFrameTime == -1.f) {
-			_lastFrameTime = currentTime;
-		}
-
-		auto deltaTime = currentTime - _lastFrameTime;
-		_lastFrameTime = currentTime;
-
-		if (glfwWindowShouldClose(_window)) {
-			_running = false;
-			continue;
-		}
-
-		// Call function to update triangles
-		update(deltaTime);
-		// Call function to render triangles
-		draw();
-	}
-
-	glfwTerminate();
+void Application::releaseGraphics() {
+	// Textures are deleted with the last object using them, which needs the context
+	_scene.Clear();
+	_renderQueue.Release();
+	_shader = Shader{};
+	_cameraBuffer.Release();
+	_lightsBuffer.Release();
+	GeometryCache::Get().Clear();
+	GeometryArena::Get().Release();
+	TextureLoader::Get().Shutdown();
 }
 
-bool Application::openWindow() {
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	_window = glfwCreateWindow(_width, _height, _applicationName.c_str(), nullptr, nullptr);
-
-	if (!_window) {
-		std::cerr << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-	}
-
-	glfwMakeContextCurrent(_window);
-
-	glfwSetWindowUserPointer(_window, (void*)this);
-
-	glfwSetFramebufferSizeCallback(_window, [](GLFWwindow* window, int width, int height) {
-		glViewport(0, 0, width, height);
-
-		auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-		app->_width = width;
-		app->_height = height;
-
-		app->_camera.SetAspectRatio((float) width / (float) height);
-	});
-
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		std::cerr << "Failed to initialize GLAD" << std::endl;
-		glfwTerminate();
-		return false;
-	}
+void Application::setupGraphicsState() {
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_BLEND);
 	glEnable(GL_DEPTH_TEST);
@@ -94,33 +46,6 @@ bool Application::openWindow() {
 	glFrontFace(GL_CCW);
 	glCullFace(GL_BACK);
 	glEnable(GL_CULL_FACE);
-
-	return true;
-}
-
-void Application::setupInputs() {
-	glfwSetKeyCallback(_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-		auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-
-		switch (key) {
-		case GLFW_KEY_ESCAPE:
-			if (action == GLFW_PRESS) {
-				app->_running = false;
-			}
-			break;
-		case GLFW_KEY_F11:
-			if (action == GLFW_PRESS) {
-				app->_camera.SetIsPerspective(!app->_camera.IsPerspective());
-			}
-			break;
-		default: {}
-		}
-	});
-
-	glfwSetScrollCallback(_window, [](GLFWwindow* window, double xoffset, double yoffset) {
-		auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
-		app->incrementCameraSpeed((float)yoffset * 2);
-	});
 }
 
 void Application::setupScene() {
@@ -129,165 +54,136 @@ void Application::setupScene() {
 	Path fragmentShaderPath = shaderPath / "lighting.fs";
 	_shader = Shader(vertexShaderPath, fragmentShaderPath);
 
-	// Add lights
-	glm::vec3 lightColor = { 1.f, 1.f, 1.f };
-	float ambientIntensity = 0.2f;
-	float diffuseIntensity = 0.8f;
-	float specularIntensity = 0.5;
-	_dirLight = DirectionalLight{
-		.direction = { 0.f, -1.0f, -1.f },
-		.ambient = lightColor * ambientIntensity,
-		.diffuse = lightColor * diffuseIntensity,
-		.specular = lightColor * specularIntensity
-	};
-
-	lightColor = { 1.f, 0.5f, 0.5f };
-	PointLight light1 = {
-		.position = { -4.f, 5.5f, -4.f },
-		.ambient = lightColor * ambientIntensity,
-		.diffuse = lightColor * diffuseIntensity,
-		.specular = lightColor * specularIntensity
-	};
-	lightColor = { 0.5f, 0.5f, 1.0f };
-	PointLight light2 = {
-		.position = { 4.f, 5.5f, -4.f },
-		.ambient = lightColor * ambientIntensity,
-		.diffuse = lightColor * diffuseIntensity,
-		.specular = lightColor * specularIntensity
-	};
-	_pointLights.emplace_back(light1);
-	_pointLights.emplace_back(light2);
+	_cameraBuffer = UniformBuffer<CameraBlock>(UniformBlock::Camera);
+	_lightsBuffer = UniformBuffer<LightsBlock>(UniformBlock::Lights);
 
-	auto plane = Object::CreatePlane();
-	auto stand = Object::CreateStand();
-	auto monitor = Object::CreateMonitor();
-	monitor.Transform = glm::translate(monitor.Transform, { 0.f, 1.f, -0.5f });
-	
-	auto clock = Object::CreateClock();
-	clock.Transform = glm::translate(clock.Transform, { 1.75f, 1.f, 0.2f });
-
-	auto book = Object::CreateBook();
-	book.Transform = glm::translate(book.Transform, { 3.f, 1.f, 0.f });
-
-	auto ball = Object::CreateBall();
-	ball.Transform = glm::translate(ball.Transform, { -2.5f, 1.f, 0.3f });
-
-	auto jewelAngle = glm::radians(45.f);
-	auto jewel = Object::CreateJewel();
-	jewel.Transform = glm::translate(jewel.Transform, { 0.f, 1.f, 0.5 });
-
-	auto spinAngle = glm::two_pi<float>() / 24;
-	auto tiltAngle = glm::radians(45.f);
-	jewel.Transform = glm::rotate(jewel.Transform, spinAngle, glm::vec3(0.f, 1.f, 0.f));
-	jewel.Transform = glm::rotate(jewel.Transform, tiltAngle, glm::vec3(glm::cos(spinAngle), 0.f, glm::sin(spinAngle)));
-	
-
-	_objects.push_back(plane);
-	_objects.push_back(stand);
-	_objects.push_back(monitor);
-	_objects.push_back(clock);
-	_objects.push_back(book);
-	_objects.push_back(ball);
-	_objects.push_back(jewel);
+	if (_sceneDescription.empty()) {
+		_sceneDescription = std::filesystem::current_path() / "assets" / "scenes" / "desk.txt";
+	}
+	SceneDescription description{};
+	SceneDescription::Load(_sceneDescription, description);
+	_dirLight = description.dirLight;
+	_pointLights = description.pointLights;
+
+	// The binary file is a snapshot of the description, taken again once the description is newer
+	std::error_code error{};
+	bool stale = std::filesystem::last_write_time(_sceneDescription, error) > std::filesystem::last_write_time(_sceneFile, error);
+	_sceneMapped = !_sceneFile.empty() && !stale && SceneFile::Load(_sceneFile, _scene);
+	if (!_sceneMapped) {
+		_sceneBuilder.Apply(description, _scene);
+		if (!_sceneFile.empty()) {
+			SceneFile::Save(_scene, _sceneFile);
+		}
+	}
+	_sceneWatcher = FileWatcher{ _sceneDescription };
 }
 
-bool Application::update(double deltaTime) {
-	glfwPollEvents();
+void Application::reloadScene() {
+	auto start = std::chrono::steady_clock::now();
+	SceneDescription description{};
+	if (!SceneDescription::Load(_sceneDescription, description)) {
+		return;
+	}
 
-	handleInput(deltaTime);
+	// A mapped scene was not built by the builder, it is replaced once and kept in step from then on
+	if (_sceneMapped) {
+		_scene.Clear();
+		_sceneBuilder.Reset();
+		_sceneMapped = false;
+	}
 
-	return false;
+	_dirLight = description.dirLight;
+	_pointLights = description.pointLights;
+	auto stats = _sceneBuilder.Apply(description, _scene);
+	std::cout << "Reloaded " << _sceneDescription.filename() << " in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms: "
+		<< stats.unchanged << " unchanged, " << stats.updated << " updated, " << stats.rebuilt << " rebuilt, "
+		<< stats.added << " added, " << stats.removed << " removed" << std::endl;
 }
 
 bool Application::draw() {
+	TextureLoader::Get().Update();
+
 	// Clear the screen with specific color
 	glClearColor(.0f, .1f, .2f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Camera matrix to move objects in the plane
-	glm::mat4 view = _camera.GetViewMatrix();
-	glm::mat4 projection = _camera.GetProjectionMatrix();
-	glm::vec3 viewPos = _camera.GetPosition();
-	_shader.SetMat4("projection", projection);
-	_shader.SetMat4("view", view);
-	_shader.SetVec3("viewPos", viewPos);
-
-	for (auto& object : _objects) {
-		_shader.SetVec3("dirLight.direction", _dirLight.direction);
-		_shader.SetVec3("dirLight.ambient", _dirLight.ambient);
-		_shader.SetVec3("dirLight.diffuse", _dirLight.diffuse);
-		_shader.SetVec3("dirLight.specular", _dirLight.specular);
+	// Camera and lights are the same for every object, upload them once per frame
+	auto view = _camera.GetViewMatrix();
+	auto projection = _camera.GetProjectionMatrix();
+	_cameraBuffer.Update({
+		.view = view,
+		.projection = projection,
+		.viewPos = _camera.GetPosition()
+	});
 
-		for (auto i = 0; i < _pointLights.size(); i++) {
-			auto pointLight = _pointLights[i];
-			std::string uniformBase = "pointLights[" + std::to_string(i) + "].";
+	LightsBlock lights{ .dirLight = _dirLight };
+	lights.pointLightCount = static_cast<int32_t>(std::min(_pointLights.size(), MaxPointLights));
+	for (int32_t i = 0; i < lights.pointLightCount; i++) {
+		lights.pointLights[i] = _pointLights[i];
+	}
+	_lightsBuffer.Update(lights);
 
-			_shader.SetVec3(uniformBase + "position", pointLight.position);
-			_shader.SetVec3(uniformBase + "ambient", pointLight.ambient);
-			_shader.SetVec3(uniformBase + "diffuse", pointLight.diffuse);
-			_shader.SetVec3(uniformBase + "specular", pointLight.specular);
-			_shader.SetFloat(uniformBase + "constant", pointLight.constant);
-			_shader.SetFloat(uniformBase + "linear", pointLight.linear);
-			_shader.SetFloat(uniformBase + "quadratic", pointLight.quadratic);
-		}
+	updateScene();
+	_scene.SelectLods(_camera.GetPosition(), projection, static_cast<float>(_height), _lodBias);
 
-		object.Draw(_shader);
+	_renderQueue.Begin(_camera.GetPosition(), projection * view);
+	if (_renderQueue.UsesFrustumCulling()) {
+		_visibleRenderables.clear();
+		_sceneTree.QueryFrustum(Frustum{ projection * view }, _visibleRenderables);
+		_scene.Submit(_renderQueue, _shader, _visibleRenderables);
 	}
-
-	glfwSwapBuffers(_window);
+	else {
+		_scene.Submit(_renderQueue, _shader);
+	}
+	_renderQueue.Flush();
 
 	return false;
 }
 
-void Application::handleInput(double deltaTime) {
-	float moveAmount = _cameraSpeed * (float)deltaTime;
-
-	if (glfwGetKey(_window, GLFW_KEY_W)) {
-		_camera.MoveCamera(Camera::MoveDirection::Forward, moveAmount);
-	}
-	if (glfwGetKey(_window, GLFW_KEY_S)) {
-		_camera.MoveCamera(Camera::MoveDirection::Backward, moveAmount);
-	}
-	if (glfwGetKey(_window, GLFW_KEY_A)) {
-		_camera.MoveCamera(Camera::MoveDirection::Left, moveAmount);
-	}
-	if (glfwGetKey(_window, GLFW_KEY_D)) {
-		_camera.MoveCamera(Camera::MoveDirection::Right, moveAmount);
-	}
-	if (glfwGetKey(_window, GLFW_KEY_Q)) {
-		_camera.MoveCamera(Camera::MoveDirection::Up, moveAmount);
-	}
-	if (glfwGetKey(_window, GLFW_KEY_E)) {
-		_camera.MoveCamera(Camera::MoveDirection::Down, moveAmount);
+void Application::updateScene() {
+	// Renderables were removed and the rest renumbered, start the tree over
+	if (_treeGeneration != _scene.Generation()) {
+		for (auto proxy : _treeProxies) {
+			_sceneTree.Remove(proxy);
+		}
+		_treeProxies.clear();
+		_treeGeneration = _scene.Generation();
 	}
 
-	double xpos, ypos;
-	glfwGetCursorPos(_window, &xpos, &ypos);
+	auto changed = _scene.UpdateTransforms();
 
-	mousePositionCallback(xpos, ypos);
-}
-
-void Application::mousePositionCallback(double xpos, double ypos) {
-	if (!_firstMouse) {
-		_lastMousePosition.x = static_cast<float>(xpos);
-		_lastMousePosition.y = static_cast<float>(ypos);
-
-		_firstMouse = true;
+	// New renderables are inserted right away, moved ones are collected and applied in one update
+	auto firstNew = static_cast<uint32_t>(_treeProxies.size());
+	for (auto renderable = firstNew; renderable < _scene.RenderableCount(); renderable++) {
+		_treeProxies.push_back(_sceneTree.Insert(_scene.RenderableBounds(renderable), renderable));
+	}
+	_treeUpdates.clear();
+	for (auto renderable : changed) {
+		if (renderable < firstNew) {
+			_treeUpdates.push_back({ .proxy = _treeProxies[renderable], .box = _scene.RenderableBounds(renderable) });
+		}
 	}
-	glm::vec2 moveAmount {
-		xpos - _lastMousePosition.x,
-		_lastMousePosition.y - ypos
-	};
-
-	_camera.RotateBy(moveAmount.x * _cameraAngleSpeed.x, moveAmount.y * _cameraAngleSpeed.y);
 
-	_lastMousePosition.x = static_cast<float>(xpos);
-	_lastMousePosition.y = static_cast<float>(ypos);
+	// A bulk load builds a better tree top down than one insert at a time
+	size_t inserted = _treeProxies.size() - firstNew;
+	if (inserted > 0 && inserted * 4 > _sceneTree.LeafCount()) {
+		_sceneTree.Rebuild();
+	}
+	_sceneTree.Update(_treeUpdates, _treeUpdatePolicy);
 }
 
-void Application::incrementCameraSpeed(float amount)
-{
-	_cameraSpeed += amount;
+void Application::pickObject(double xpos, double ypos) {
+	glm::vec4 viewport{ 0.f, 0.f, static_cast<float>(_width), static_cast<float>(_height) };
+	auto view = _camera.GetViewMatrix();
+	auto projection = _camera.GetProjectionMatrix();
 
-	_cameraSpeed = std::clamp(_cameraSpeed, 1.f, 9.f);
+	// Window coordinates start at the top, GL ones at the bottom
+	float y = static_cast<float>(_height - ypos);
+	auto nearPoint = glm::unProject(glm::vec3{ static_cast<float>(xpos), y, 0.f }, view, projection, viewport);
+	auto farPoint = glm::unProject(glm::vec3{ static_cast<float>(xpos), y, 1.f }, view, projection, viewport);
+
+	auto hit = _sceneTree.Raycast(nearPoint, farPoint - nearPoint, 1.f);
+	if (hit) {
+		std::cout << "Picked entity " << _scene.RenderableEntity(hit->userData) << " at " << glm::distance(nearPoint, farPoint) * hit->distance << std::endl;
+	}
 }
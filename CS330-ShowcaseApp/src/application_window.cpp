@@ -0,0 +1,212 @@
+#include <application.h>
+#include <gl_capabilities.h>
+#include <gl_handle.h>
+#include <job_system.h>
+#include <algorithm>
+#include <iostream>
+
+// Window, input and the main loop. Everything else in the application works without GLFW,
+// so the headless benchmark can leave this file out.
+
+void Application::Run() {
+	// Open the window
+	if (!openWindow()) {
+		return;
+	}
+
+	setupInputs();
+	// Update and draw list building spread over every core, GL stays on this thread
+	JobSystem::Get().Start();
+
+	_running = true;
+
+	// Arrange the elements in the window
+	setupScene();
+
+	// Run app
+	while (_running){
+		double currentTime = glfwGetTime();
+
+		if (_lastFrameTime == -1.f) {
+			_lastFrameTime = currentTime;
+		}
+
+		auto deltaTime = currentTime - _lastFrameTime;
+		_lastFrameTime = currentTime;
+
+		if (glfwWindowShouldClose(_window)) {
+			_running = false;
+			continue;
+		}
+
+		// Call function to update triangles
+		update(deltaTime);
+		// Call function to render triangles
+		draw();
+		glfwSwapBuffers(_window);
+	}
+
+	releaseGraphics();
+	GLLeakTracker::Report(std::cerr);
+	glfwTerminate();
+}
+
+bool Application::openWindow() {
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	_window = glfwCreateWindow(_width, _height, _applicationName.c_str(), nullptr, nullptr);
+
+	if (!_window) {
+		std::cerr << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+	}
+
+	glfwMakeContextCurrent(_window);
+
+	glfwSetWindowUserPointer(_window, (void*)this);
+
+	glfwSetFramebufferSizeCallback(_window, [](GLFWwindow* window, int width, int height) {
+		glViewport(0, 0, width, height);
+
+		auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		app->_width = width;
+		app->_height = height;
+
+		app->_camera.SetAspectRatio((float) width / (float) height);
+	});
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	GLCapabilities::Detect((GLADloadproc)glfwGetProcAddress);
+
+	setupGraphicsState();
+
+	return true;
+}
+
+void Application::setupInputs() {
+	glfwSetKeyCallback(_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+		auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+
+		switch (key) {
+		case GLFW_KEY_ESCAPE:
+			if (action == GLFW_PRESS) {
+				app->_running = false;
+			}
+			break;
+		case GLFW_KEY_F11:
+			if (action == GLFW_PRESS) {
+				app->_camera.SetIsPerspective(!app->_camera.IsPerspective());
+			}
+			break;
+		case GLFW_KEY_F9:
+			if (action == GLFW_PRESS) {
+				app->_renderQueue.SetFrustumCulling(!app->_renderQueue.UsesFrustumCulling());
+			}
+			break;
+		case GLFW_KEY_F10:
+			if (action == GLFW_PRESS) {
+				app->_renderQueue.SetMultiDrawIndirect(!app->_renderQueue.UsesMultiDrawIndirect());
+			}
+			break;
+		case GLFW_KEY_LEFT_BRACKET:
+		case GLFW_KEY_RIGHT_BRACKET:
+			if (action == GLFW_PRESS) {
+				app->_lodBias = std::clamp(key == GLFW_KEY_LEFT_BRACKET ? app->_lodBias / 2 : app->_lodBias * 2, 1.f / 16, 16.f);
+				std::cout << "LOD bias " << app->_lodBias << std::endl;
+			}
+			break;
+		default: {}
+		}
+	});
+
+	glfwSetMouseButtonCallback(_window, [](GLFWwindow* window, int button, int action, int mods) {
+		auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+
+		if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+			double xpos, ypos;
+			glfwGetCursorPos(window, &xpos, &ypos);
+			app->pickObject(xpos, ypos);
+		}
+	});
+
+	glfwSetScrollCallback(_window, [](GLFWwindow* window, double xoffset, double yoffset) {
+		auto* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		app->incrementCameraSpeed((float)yoffset * 2);
+	});
+}
+
+bool Application::update(double deltaTime) {
+	glfwPollEvents();
+
+	handleInput(deltaTime);
+	if (_sceneWatcher.Changed()) {
+		reloadScene();
+	}
+	if (_shader.Update()) {
+		std::cout << "Reloaded shaders" << std::endl;
+	}
+	_scene.RunSystems(static_cast<float>(deltaTime));
+
+	return false;
+}
+
+void Application::handleInput(double deltaTime) {
+	float moveAmount = _cameraSpeed * (float)deltaTime;
+
+	if (glfwGetKey(_window, GLFW_KEY_W)) {
+		_camera.MoveCamera(Camera::MoveDirection::Forward, moveAmount);
+	}
+	if (glfwGetKey(_window, GLFW_KEY_S)) {
+		_camera.MoveCamera(Camera::MoveDirection::Backward, moveAmount);
+	}
+	if (glfwGetKey(_window, GLFW_KEY_A)) {
+		_camera.MoveCamera(Camera::MoveDirection::Left, moveAmount);
+	}
+	if (glfwGetKey(_window, GLFW_KEY_D)) {
+		_camera.MoveCamera(Camera::MoveDirection::Right, moveAmount);
+	}
+	if (glfwGetKey(_window, GLFW_KEY_Q)) {
+		_camera.MoveCamera(Camera::MoveDirection::Up, moveAmount);
+	}
+	if (glfwGetKey(_window, GLFW_KEY_E)) {
+		_camera.MoveCamera(Camera::MoveDirection::Down, moveAmount);
+	}
+
+	double xpos, ypos;
+	glfwGetCursorPos(_window, &xpos, &ypos);
+
+	mousePositionCallback(xpos, ypos);
+}
+
+void Application::mousePositionCallback(double xpos, double ypos) {
+	if (!_firstMouse) {
+		_lastMousePosition.x = static_cast<float>(xpos);
+		_lastMousePosition.y = static_cast<float>(ypos);
+
+		_firstMouse = true;
+	}
+	glm::vec2 moveAmount {
+		xpos - _lastMousePosition.x,
+		_lastMousePosition.y - ypos
+	};
+
+	_camera.RotateBy(moveAmount.x * _cameraAngleSpeed.x, moveAmount.y * _cameraAngleSpeed.y);
+
+	_lastMousePosition.x = static_cast<float>(xpos);
+	_lastMousePosition.y = static_cast<float>(ypos);
+}
+
+void Application::incrementCameraSpeed(float amount)
+{
+	_cameraSpeed += amount;
+
+	_cameraSpeed = std::clamp(_cameraSpeed, 1.f, 9.f);
+}
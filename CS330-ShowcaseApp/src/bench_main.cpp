@@ -0,0 +1,19 @@
+#include <benchmark.h>
+#include <gl_handle.h>
+#include <iostream>
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options{};
+
+	if (!Benchmark::ParseArguments(argc, argv, options)) {
+		return 2;
+	}
+
+	Benchmark benchmark{ options };
+
+	auto result = benchmark.Run();
+
+	// The offscreen context is gone by now, anything still alive was never deleted
+	GLLeakTracker::Report(std::cerr);
+	return result;
+}
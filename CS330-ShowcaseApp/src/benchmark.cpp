@@ -0,0 +1,534 @@
+#include <benchmark.h>
+#include <allocation_counter.h>
+#include <geometry_cache.h>
+#include <gl_capabilities.h>
+#include <gl_counters.h>
+#include <headless_context.h>
+#include <job_system.h>
+#include <mesh_optimizer.h>
+#include <texture_array.h>
+#include <texture_cook.h>
+#include <texture_loader.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image_write.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+Benchmark::Benchmark(BenchmarkOptions options) : _options{ options }
+{}
+
+bool Benchmark::ParseArguments(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "--frames" && hasValue) {
+			options.frames = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (argument == "--warmup" && hasValue) {
+			options.warmupFrames = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--width" && hasValue) {
+			options.width = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (argument == "--height" && hasValue) {
+			options.height = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (argument == "--books" && hasValue) {
+			options.books = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--indirect" && hasValue) {
+			options.multiDrawIndirect = std::atoi(argv[++i]) != 0;
+		}
+		else if (argument == "--move-books" && hasValue) {
+			options.movingBooks = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--balls" && hasValue) {
+			options.balls = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--lod-bias" && hasValue) {
+			options.lodBias = std::clamp(static_cast<float>(std::atof(argv[++i])), 1.f / 16, 16.f);
+		}
+		else if (argument == "--primitives" && hasValue) {
+			options.primitives = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--scene" && hasValue) {
+			options.scene = argv[++i];
+		}
+		else if (argument == "--description" && hasValue) {
+			options.description = argv[++i];
+		}
+		else if (argument == "--reload" && hasValue) {
+			options.reloadDescription = argv[++i];
+		}
+		else if (argument == "--tree-update" && hasValue) {
+			std::string policy = argv[++i];
+			options.treeUpdatePolicy = policy == "reinsert" ? AabbTreeUpdatePolicy::Reinsert
+				: policy == "refit" ? AabbTreeUpdatePolicy::Refit
+				: policy == "rebuild" ? AabbTreeUpdatePolicy::Rebuild
+				: AabbTreeUpdatePolicy::Auto;
+		}
+		else if (argument == "--cull" && hasValue) {
+			options.frustumCulling = std::atoi(argv[++i]) != 0;
+		}
+		else if (argument == "--vertex-format" && hasValue) {
+			std::string format = argv[++i];
+			if (format == "float") {
+				options.vertexFormat = VertexFormat::Float;
+			}
+			else if (format == "half") {
+				options.vertexFormat = VertexFormat::PackedHalf;
+			}
+			else {
+				options.vertexFormat = VertexFormat::Packed;
+			}
+		}
+		else if (argument == "--threads" && hasValue) {
+			options.threads = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (argument == "--cook") {
+			options.cookTextures = true;
+		}
+		else if (argument == "--output" && hasValue) {
+			options.output = argv[++i];
+		}
+		else if (argument == "--screenshot" && hasValue) {
+			options.screenshot = argv[++i];
+		}
+		else {
+			std::cerr << "Usage: showcase_bench [--frames N] [--warmup N] [--width W] [--height H] [--books N] [--move-books N] [--balls N] [--lod-bias F] [--primitives N] [--scene file.scene] [--description scene.txt] [--reload scene.txt] [--tree-update auto|reinsert|refit|rebuild] [--indirect 0|1] [--cull 0|1] [--vertex-format float|packed|half] [--threads N] [--cook] [--output file.json] [--screenshot file.png]" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int Benchmark::Run()
+{
+	if (_options.cookTextures) {
+		auto cooked = TextureCook::CookDirectory(Texture::texturePath);
+		std::cout << "Cooked " << cooked << " textures into " << TextureCook::cachePath << std::endl;
+		return 0;
+	}
+
+	HeadlessContext context{ _options.width, _options.height };
+	if (!context.IsValid()) {
+		return 1;
+	}
+
+	GLCounters::Install();
+	MeshOptimizer::RecordReports(true);
+	JobSystem::Get().Start(static_cast<uint32_t>(_options.threads));
+
+	Application app{ "showcase_bench", _options.width, _options.height };
+	app.setupGraphicsState();
+	app._renderQueue.SetMultiDrawIndirect(_options.multiDrawIndirect);
+	app._renderQueue.SetFrustumCulling(_options.frustumCulling);
+	app._treeUpdatePolicy = _options.treeUpdatePolicy;
+	app._lodBias = _options.lodBias;
+	app.SetSceneFile(_options.scene);
+	app.SetSceneDescription(_options.description);
+	Mesh::DefaultVertexFormat = _options.vertexFormat;
+
+	GLCounters::Reset();
+	auto setupStart = Clock::now();
+	app.setupScene();
+	addBooks(app);
+	addBalls(app);
+	glFinish();
+
+	SetupSample setup{ .setupMs = millisecondsSince(setupStart) };
+	if (_options.primitives > 0) {
+		auto primitivesStart = Clock::now();
+		loadPrimitives();
+		glFinish();
+		setup.primitivesMs = millisecondsSince(primitivesStart);
+	}
+	if (!_options.reloadDescription.empty()) {
+		SceneDescription description{};
+		if (SceneDescription::Load(_options.reloadDescription, description)) {
+			auto bytesUploaded = GLCounters::Values().bytesUploaded;
+			auto reloadStart = Clock::now();
+			setup.reload = app._sceneBuilder.Apply(description, app._scene);
+			glFinish();
+			setup.reloadMs = millisecondsSince(reloadStart);
+			setup.reloadBytesUploaded = GLCounters::Values().bytesUploaded - bytesUploaded;
+		}
+	}
+	placeCamera(app._camera, 0);
+	app.draw();
+	glFinish();
+	setup.firstFrameMs = millisecondsSince(setupStart);
+
+	// Measured frames should not depend on how fast the textures stream in
+	TextureLoader::Get().Finish();
+	glFinish();
+	setup.texturesReadyMs = millisecondsSince(setupStart);
+	setup.bytesUploaded = GLCounters::Values().bytesUploaded;
+
+	std::vector<FrameSample> samples{};
+	samples.reserve(_options.frames);
+
+	for (int frame = -_options.warmupFrames; frame < _options.frames; frame++) {
+		if (frame == 0) {
+			JobSystem::Get().ResetStats();
+		}
+
+		placeCamera(app._camera, std::max(frame, 0));
+		_frame = frame;
+		AllocationCounter::Reset();
+		auto systemsStart = Clock::now();
+		app._scene.RunSystems(1.f / 60.f);
+		double systemsMs = millisecondsSince(systemsStart);
+		GLCounters::Reset();
+
+		// Timed on its own here, draw then finds nothing left to update
+		auto frameStart = Clock::now();
+		app.updateScene();
+		double sceneUpdateMs = millisecondsSince(frameStart);
+		auto treeStats = app._sceneTree.Stats();
+		auto worldMatrixUpdates = app._scene.WorldMatrixUpdates();
+		app.draw();
+		double cpuMs = millisecondsSince(frameStart);
+		glFinish();
+		double finishMs = millisecondsSince(frameStart);
+		auto allocations = AllocationCounter::Allocations();
+
+		if (frame < 0) {
+			continue;
+		}
+
+		auto& counters = GLCounters::Values();
+		auto& queueStats = app._renderQueue.Stats();
+		samples.push_back({
+			.cpuMs = cpuMs,
+			.systemsMs = systemsMs,
+			.sceneUpdateMs = sceneUpdateMs,
+			.finishMs = finishMs,
+			.allocations = allocations,
+			.glCalls = counters.glCalls,
+			.drawCalls = counters.drawCalls,
+			.bytesUploaded = counters.bytesUploaded,
+			.culled = queueStats.culled,
+			.visible = queueStats.visible,
+			.batches = queueStats.batches,
+			.triangles = queueStats.triangles,
+			.lodSwitches = app._scene.LodSwitches(),
+			.treeReinserted = treeStats.reinserted,
+			.treeRefit = treeStats.refit,
+			.treeRebuilds = treeStats.rebuilds,
+			.worldMatrixUpdates = worldMatrixUpdates,
+			.normalMatrixInverses = queueStats.normalMatrixInverses,
+			.stateChanges = queueStats.stateChanges,
+			.stateChangesSaved = queueStats.StateChangesSaved()
+		});
+	}
+
+	if (!_options.screenshot.empty()) {
+		auto pixels = context.ReadPixels();
+		stbi_flip_vertically_on_write(true);
+		stbi_write_png(_options.screenshot.string().c_str(), _options.width, _options.height, 4, pixels.data(), _options.width * 4);
+	}
+
+	auto json = toJson(app, setup, samples, JobSystem::Get().Stats());
+	app.releaseGraphics();
+	if (_options.output.empty()) {
+		std::cout << json << std::endl;
+	}
+	else {
+		std::ofstream file{ _options.output };
+		file << json << std::endl;
+	}
+
+	return 0;
+}
+
+void Benchmark::placeCamera(Camera& camera, int frame)
+{
+	// One full orbit around the desk over the measured frames, bobbing up and down twice
+	float t = static_cast<float>(frame) / static_cast<float>(_options.frames);
+	float angle = t * glm::two_pi<float>();
+	float radius = 9.f + 2.f * glm::sin(angle * 3.f);
+	glm::vec3 target{ 0.f, 1.5f, 0.f };
+
+	camera.SetPosition({ radius * glm::sin(angle), 4.5f + 1.5f * glm::sin(angle * 2.f), radius * glm::cos(angle) });
+	camera.LookAt(target);
+}
+
+void Benchmark::addBooks(Application& app)
+{
+	if (_options.books == 0) {
+		return;
+	}
+
+	// Clones share the mesh and material of one book, they only differ in transform and tint
+	auto& scene = app._scene;
+	auto book = Object::CreateBook(scene);
+	int moving = std::min(_options.movingBooks, _options.books);
+	for (int i = 0; i < _options.books; i++) {
+		auto entity = i == 0 ? book : scene.Clone(book);
+		uint32_t hash = static_cast<uint32_t>(i) * 2654435761u;
+		scene.SetTint(entity, glm::vec4{ 0.5f + (hash & 0xff) / 510.f, 0.5f + ((hash >> 8) & 0xff) / 510.f, 0.5f + ((hash >> 16) & 0xff) / 510.f, 1.f });
+		scene.SetTransform(entity, bookTransform(i, 0.f));
+		if (i < moving) {
+			scene.Add(entity, SlidingBook{ i });
+		}
+	}
+
+	if (moving > 0) {
+		scene.AddSystem("slide books", [this](Scene& scene, float) { slideBooks(scene); });
+	}
+}
+
+void Benchmark::loadPrimitives()
+{
+	// Every shape is asked for about four times, so a quarter of the batch is generated
+	std::vector<PrimitiveParams> params{};
+	params.reserve(_options.primitives);
+	int distinct = std::max(_options.primitives / 4, 1);
+	for (int i = 0; i < _options.primitives; i++) {
+		int shape = i % distinct;
+		float size = 0.5f + (shape / 4) * 0.01f;
+		switch (shape % 4) {
+		case 0:
+			params.push_back(PrimitiveParams::Box(size, size * 2, size));
+			break;
+		case 1:
+			params.push_back(PrimitiveParams::Circle(size, 32));
+			break;
+		case 2:
+			params.push_back(PrimitiveParams::Cylinder(size * 2, size, size, 32));
+			break;
+		default:
+			params.push_back(PrimitiveParams::Sphere(size, 16, 32));
+			break;
+		}
+	}
+
+	GeometryCache::Get().Load(params);
+}
+
+void Benchmark::addBalls(Application& app)
+{
+	if (_options.balls == 0) {
+		return;
+	}
+
+	// Rows of ten behind the desk, two units apart, so the far rows only cover a few pixels
+	constexpr int ballsPerRow = 10;
+	auto& scene = app._scene;
+	auto ball = Object::CreateBall(scene);
+	for (int i = 0; i < _options.balls; i++) {
+		auto entity = i == 0 ? ball : scene.Clone(ball);
+		float x = (i % ballsPerRow - (ballsPerRow - 1) / 2.f) * 2.f;
+		float z = -6.f - (i / ballsPerRow) * 2.f;
+		scene.SetTransform(entity, glm::translate(glm::mat4{ 1.f }, { x, 0.f, z }));
+	}
+}
+
+glm::mat4 Benchmark::bookTransform(int book, float slide)
+{
+	constexpr int booksPerStack = 40;
+	int stacks = (_options.books + booksPerStack - 1) / booksPerStack;
+	int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(stacks))));
+
+	int stack = book / booksPerStack;
+	float x = (stack % columns - columns / 2) * 2.f + slide;
+	float z = -4.f - (stack / columns) * 3.f;
+	float y = (book % booksPerStack) * 0.1f;
+
+	uint32_t hash = static_cast<uint32_t>(book) * 2654435761u;
+	auto transform = glm::translate(glm::mat4{ 1.f }, { x, y, z });
+	return glm::rotate(transform, (hash >> 24) / 255.f * 0.3f - 0.15f, glm::vec3{ 0.f, 1.f, 0.f });
+}
+
+void Benchmark::slideBooks(Scene& scene)
+{
+	// Books slide sideways out of their stacks, far enough to leave the tree's margins most frames
+	auto& books = scene.Components<SlidingBook>();
+	auto entities = books.Entities();
+	auto components = books.Components();
+	JobSystem::Get().ParallelFor(books.Size(), 1024, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			int book = components[i].index;
+			float slide = glm::sin(_frame * 0.2f + book * 0.37f) * 0.75f;
+			scene.SetTransform(entities[i], bookTransform(book, slide));
+		}
+	});
+}
+
+// Driver strings are free text and may hold quotes, backslashes or control characters
+static std::string jsonEscape(std::string_view text) {
+	static constexpr char hex[] = "0123456789abcdef";
+	std::string escaped{};
+	escaped.reserve(text.size());
+	for (auto c : text) {
+		auto byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (byte < 0x20) {
+			escaped += "\\u00";
+			escaped += hex[byte >> 4];
+			escaped += hex[byte & 0xf];
+		}
+		else {
+			escaped += c;
+		}
+	}
+
+	return escaped;
+}
+
+template <typename T>
+static void writeDistribution(std::ostringstream& json, const char* name, std::vector<T> values, bool last = false) {
+	std::sort(values.begin(), values.end());
+
+	auto percentile = [&](double p) {
+		auto index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+		return values[index];
+	};
+	double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+
+	json << "    \"" << jsonEscape(name) << "\": { "
+		<< "\"min\": " << values.front() << ", "
+		<< "\"mean\": " << mean << ", "
+		<< "\"p50\": " << percentile(0.50) << ", "
+		<< "\"p90\": " << percentile(0.90) << ", "
+		<< "\"p95\": " << percentile(0.95) << ", "
+		<< "\"p99\": " << percentile(0.99) << ", "
+		<< "\"max\": " << values.back() << " }" << (last ? "\n" : ",\n");
+}
+
+static const char* treeUpdatePolicyName(AabbTreeUpdatePolicy policy) {
+	switch (policy) {
+	case AabbTreeUpdatePolicy::Reinsert: return "reinsert";
+	case AabbTreeUpdatePolicy::Refit: return "refit";
+	case AabbTreeUpdatePolicy::Rebuild: return "rebuild";
+	default: return "auto";
+	}
+}
+
+static const char* vertexFormatName(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Float: return "float";
+	case VertexFormat::PackedHalf: return "half";
+	default: return "packed";
+	}
+}
+
+std::string Benchmark::toJson(Application& app, const SetupSample& setup, const std::vector<FrameSample>& samples, const std::vector<WorkerStats>& workers)
+{
+	auto collect = [&](auto member) {
+		std::vector<std::decay_t<decltype(samples[0].*member)>> values{};
+		values.reserve(samples.size());
+		for (auto& sample : samples) {
+			values.push_back(sample.*member);
+		}
+		return values;
+	};
+
+	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+	std::ostringstream json{};
+	json << "{\n"
+		<< "  \"renderer\": \"" << jsonEscape(renderer ? renderer : "unknown") << "\",\n"
+		<< "  \"version\": \"" << jsonEscape(version ? version : "unknown") << "\",\n"
+		<< "  \"width\": " << _options.width << ",\n"
+		<< "  \"height\": " << _options.height << ",\n"
+		<< "  \"frames\": " << samples.size() << ",\n"
+		<< "  \"books\": " << _options.books << ",\n"
+		<< "  \"balls\": " << _options.balls << ",\n"
+		<< "  \"lod_bias\": " << _options.lodBias << ",\n"
+		<< "  \"moving_books\": " << std::min(_options.movingBooks, _options.books) << ",\n"
+		<< "  \"tree_update\": \"" << jsonEscape(treeUpdatePolicyName(_options.treeUpdatePolicy)) << "\",\n"
+		<< "  \"tree_height\": " << app._sceneTree.Height() << ",\n"
+		<< "  \"tree_cost\": " << app._sceneTree.Cost() << ",\n"
+		<< "  \"frustum_culling\": " << (_options.frustumCulling ? "true" : "false") << ",\n"
+		<< "  \"multi_draw_indirect\": " << (_options.multiDrawIndirect && GLCapabilities::Get().multiDrawIndirect ? "true" : "false") << ",\n"
+		<< "  \"program_binary_cache\": " << (GLCapabilities::Get().programBinary ? "true" : "false") << ",\n"
+		<< "  \"vertex_format\": \"" << jsonEscape(vertexFormatName(_options.vertexFormat)) << "\",\n"
+		<< "  \"warmup_frames\": " << _options.warmupFrames << ",\n"
+		<< "  \"setup_ms\": " << setup.setupMs << ",\n"
+		<< "  \"first_frame_ms\": " << setup.firstFrameMs << ",\n"
+		<< "  \"textures_ready_ms\": " << setup.texturesReadyMs << ",\n"
+		<< "  \"setup_bytes_uploaded\": " << setup.bytesUploaded << ",\n"
+		<< "  \"primitives\": " << _options.primitives << ",\n"
+		<< "  \"primitives_ms\": " << setup.primitivesMs << ",\n"
+		<< "  \"scene_reload_ms\": " << setup.reloadMs << ",\n"
+		<< "  \"scene_reload_bytes_uploaded\": " << setup.reloadBytesUploaded << ",\n"
+		<< "  \"scene_reload\": { \"unchanged\": " << setup.reload.unchanged << ", \"updated\": " << setup.reload.updated
+		<< ", \"rebuilt\": " << setup.reload.rebuilt << ", \"added\": " << setup.reload.added << ", \"removed\": " << setup.reload.removed << " },\n"
+		<< "  \"geometry_cache_hits\": " << GeometryCache::Get().Stats().hits << ",\n"
+		<< "  \"geometry_cache_misses\": " << GeometryCache::Get().Stats().misses << ",\n"
+		<< "  \"geometry_bytes\": " << GeometryArena::Get().UsedBytes() << ",\n"
+		<< "  \"textures_resident\": " << TextureRegistry::Get().ResidentCount() << ",\n"
+		<< "  \"texture_bytes_resident\": " << TextureRegistry::Get().ResidentBytes() << ",\n"
+		<< "  \"texture_array_bytes\": " << TextureArray::AllocatedBytes() << ",\n"
+		<< "  \"threads\": " << workers.size() << ",\n"
+		<< "  \"workers\": [\n";
+	// Over the measured frames, worker 0 is the render thread
+	for (size_t i = 0; i < workers.size(); i++) {
+		json << "    { \"busy_ms\": " << workers[i].busyMs
+			<< ", \"utilization\": " << workers[i].utilization
+			<< ", \"jobs\": " << workers[i].jobs
+			<< ", \"steals\": " << workers[i].steals << " }" << (i + 1 < workers.size() ? ",\n" : "\n");
+	}
+	json << "  ],\n"
+		<< "  \"optimized_meshes\": [\n";
+	// Every mesh MeshOptimizer reordered during setup, cache stats simulate a 16 entry FIFO
+	auto meshReports = MeshOptimizer::Reports();
+	for (size_t i = 0; i < meshReports.size(); i++) {
+		auto& report = meshReports[i];
+		json << "    { \"vertices\": " << report.vertices
+			<< ", \"triangles\": " << report.triangles
+			<< ", \"clusters\": " << report.clusters
+			<< ", \"acmr_before\": " << report.before.acmr
+			<< ", \"acmr_after\": " << report.after.acmr
+			<< ", \"atvr_before\": " << report.before.atvr
+			<< ", \"atvr_after\": " << report.after.atvr << " }" << (i + 1 < meshReports.size() ? ",\n" : "\n");
+	}
+	json << "  ],\n"
+		<< "  \"per_frame\": {\n";
+	writeDistribution(json, "cpu_ms", collect(&FrameSample::cpuMs));
+	writeDistribution(json, "finish_ms", collect(&FrameSample::finishMs));
+	writeDistribution(json, "allocations", collect(&FrameSample::allocations));
+	writeDistribution(json, "systems_ms", collect(&FrameSample::systemsMs));
+	writeDistribution(json, "scene_update_ms", collect(&FrameSample::sceneUpdateMs));
+	writeDistribution(json, "tree_reinserted", collect(&FrameSample::treeReinserted));
+	writeDistribution(json, "tree_refit", collect(&FrameSample::treeRefit));
+	writeDistribution(json, "tree_rebuilds", collect(&FrameSample::treeRebuilds));
+	writeDistribution(json, "world_matrix_updates", collect(&FrameSample::worldMatrixUpdates));
+	writeDistribution(json, "gl_calls", collect(&FrameSample::glCalls));
+	writeDistribution(json, "draw_calls", collect(&FrameSample::drawCalls));
+	writeDistribution(json, "bytes_uploaded", collect(&FrameSample::bytesUploaded));
+	writeDistribution(json, "culled", collect(&FrameSample::culled));
+	writeDistribution(json, "visible", collect(&FrameSample::visible));
+	writeDistribution(json, "batches", collect(&FrameSample::batches));
+	writeDistribution(json, "triangles", collect(&FrameSample::triangles));
+	writeDistribution(json, "lod_switches", collect(&FrameSample::lodSwitches));
+	writeDistribution(json, "normal_matrix_inverses", collect(&FrameSample::normalMatrixInverses));
+	writeDistribution(json, "state_changes", collect(&FrameSample::stateChanges));
+	writeDistribution(json, "state_changes_saved", collect(&FrameSample::stateChangesSaved), true);
+	json << "  }\n}";
+
+	return json.str();
+}
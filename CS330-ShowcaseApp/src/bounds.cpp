@@ -0,0 +1,231 @@
+#include <bounds.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define BOUNDS_SSE 1
+#endif
+
+BoundingBox BoundingBox::FromVertices(std::span<const Vertex> vertices)
+{
+	if (vertices.empty()) {
+		return {};
+	}
+
+	BoundingBox box{ .min = glm::vec3{ FLT_MAX }, .max = glm::vec3{ -FLT_MAX } };
+	for (auto& vertex : vertices) {
+		box.min = glm::min(box.min, vertex.Position);
+		box.max = glm::max(box.max, vertex.Position);
+	}
+
+	return box;
+}
+
+float BoundingBox::SurfaceArea() const
+{
+	glm::vec3 size = max - min;
+	return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+BoundingBox BoundingBox::Transformed(const glm::mat4& transform) const
+{
+	// Arvo: the new half extent on each axis is the absolute linear part applied to the old one
+	glm::vec3 center = transform * glm::vec4{ Center(), 1.f };
+	glm::vec3 extents = Extents();
+	glm::vec3 newExtents{};
+	for (int column = 0; column < 3; column++) {
+		newExtents += glm::abs(glm::vec3{ transform[column] }) * extents[column];
+	}
+
+	return { .min = center - newExtents, .max = center + newExtents };
+}
+
+BoundingSphere BoundingSphere::FromVertices(std::span<const Vertex> vertices, const BoundingBox& box)
+{
+	BoundingSphere sphere{ .center = box.Center() };
+	for (auto& vertex : vertices) {
+		sphere.radius = std::max(sphere.radius, glm::distance(sphere.center, vertex.Position));
+	}
+
+	return sphere;
+}
+
+BoundingSphere BoundingSphere::Transformed(const glm::mat4& transform) const
+{
+	float scale = std::max({ glm::length(glm::vec3{ transform[0] }), glm::length(glm::vec3{ transform[1] }), glm::length(glm::vec3{ transform[2] }) });
+	return { .center = transform * glm::vec4{ center, 1.f }, .radius = radius * scale };
+}
+
+void BoundingBoxes::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+void BoundingBoxes::Resize(size_t count)
+{
+	centerX.resize(count);
+	centerY.resize(count);
+	centerZ.resize(count);
+	extentX.resize(count);
+	extentY.resize(count);
+	extentZ.resize(count);
+}
+
+void BoundingBoxes::Reserve(size_t count)
+{
+	centerX.reserve(count);
+	centerY.reserve(count);
+	centerZ.reserve(count);
+	extentX.reserve(count);
+	extentY.reserve(count);
+	extentZ.reserve(count);
+}
+
+void BoundingBoxes::Set(size_t index, const BoundingBox& box)
+{
+	auto center = box.Center();
+	auto extents = box.Extents();
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extents.x;
+	extentY[index] = extents.y;
+	extentZ[index] = extents.z;
+}
+
+void BoundingBoxes::Push(const BoundingBox& box)
+{
+	auto center = box.Center();
+	auto extents = box.Extents();
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Gribb and Hartmann, each plane is the fourth row plus or minus one of the others
+	auto row = [&](int index) {
+		return glm::vec4{ viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index] };
+	};
+
+	_planes = {
+		row(3) + row(0), row(3) - row(0),
+		row(3) + row(1), row(3) - row(1),
+		row(3) + row(2), row(3) - row(2)
+	};
+
+	for (auto& plane : _planes) {
+		plane /= glm::length(glm::vec3{ plane });
+	}
+}
+
+Containment Frustum::Classify(const BoundingBox& box) const
+{
+	auto center = box.Center();
+	auto extents = box.Extents();
+	auto result = Containment::Inside;
+
+	for (auto& plane : _planes) {
+		float distance = glm::dot(glm::vec3{ plane }, center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3{ plane }), extents);
+		if (distance + radius < 0.f) {
+			return Containment::Outside;
+		}
+		if (distance - radius < 0.f) {
+			result = Containment::Intersects;
+		}
+	}
+
+	return result;
+}
+
+bool Frustum::Intersects(const BoundingBox& box) const
+{
+	auto center = box.Center();
+	auto extents = box.Extents();
+
+	for (auto& plane : _planes) {
+		float distance = glm::dot(glm::vec3{ plane }, center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3{ plane }), extents);
+		if (distance + radius < 0.f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const
+{
+	for (auto& plane : _planes) {
+		if (glm::dot(glm::vec3{ plane }, sphere.center) + plane.w < -sphere.radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Frustum::Cull(const BoundingBoxes& boxes, std::vector<uint8_t>& visible) const
+{
+	visible.resize(boxes.Size());
+	Cull(boxes, 0, boxes.Size(), visible.data());
+}
+
+void Frustum::Cull(const BoundingBoxes& boxes, size_t first, size_t last, uint8_t* visible) const
+{
+	size_t i = first;
+
+#if BOUNDS_SSE
+	__m128 normalX[6], normalY[6], normalZ[6], absX[6], absY[6], absZ[6], distance[6];
+	for (size_t p = 0; p < _planes.size(); p++) {
+		normalX[p] = _mm_set1_ps(_planes[p].x);
+		normalY[p] = _mm_set1_ps(_planes[p].y);
+		normalZ[p] = _mm_set1_ps(_planes[p].z);
+		absX[p] = _mm_set1_ps(std::abs(_planes[p].x));
+		absY[p] = _mm_set1_ps(std::abs(_planes[p].y));
+		absZ[p] = _mm_set1_ps(std::abs(_planes[p].z));
+		distance[p] = _mm_set1_ps(_planes[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= last; i += 4) {
+		__m128 centerX = _mm_loadu_ps(&boxes.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&boxes.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&boxes.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+		__m128 outside = zero;
+
+		for (size_t p = 0; p < _planes.size(); p++) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, normalX[p]), _mm_mul_ps(centerY, normalY[p])),
+				_mm_add_ps(_mm_mul_ps(centerZ, normalZ[p]), distance[p]));
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, absX[p]), _mm_mul_ps(extentY, absY[p])), _mm_mul_ps(extentZ, absZ[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++) {
+			visible[i + lane] = (mask >> lane & 1) ? 0 : 1;
+		}
+	}
+#endif
+
+	for (; i < last; i++) {
+		glm::vec3 center{ boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i] };
+		glm::vec3 extents{ boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i] };
+		visible[i] = Intersects(BoundingBox{ .min = center - extents, .max = center + extents }) ? 1 : 0;
+	}
+}
@@ -63,6 +63,16 @@ void Camera::RotateBy(float yaw, float pitch)
 	recalculateVectors();
 }
 
+void Camera::LookAt(glm::vec3 target)
+{
+	auto direction = glm::normalize(target - _position);
+
+	_yaw = glm::degrees(std::atan2(direction.z, direction.x));
+	_pitch = std::clamp(glm::degrees(std::asin(direction.y)), -89.f, 89.f);
+
+	recalculateVectors();
+}
+
 void Camera::recalculateVectors()
 {
 	_lookVector = glm::normalize(
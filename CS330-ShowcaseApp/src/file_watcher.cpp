@@ -0,0 +1,106 @@
+#include <file_watcher.h>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+FileWatcher::FileWatcher(const std::filesystem::path& path) : _path{ std::filesystem::absolute(path) }
+{
+	_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_descriptor < 0 || inotify_add_watch(_descriptor, _path.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close();
+	}
+}
+
+bool FileWatcher::Changed()
+{
+	if (_descriptor < 0) {
+		return false;
+	}
+
+	bool changed = false;
+	alignas(inotify_event) char buffer[4096];
+	for (;;) {
+		auto size = read(_descriptor, buffer, sizeof(buffer));
+		if (size <= 0) {
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < size;) {
+			auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len > 0 && _path.filename() == event->name) {
+				changed = true;
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+
+	return changed;
+}
+
+void FileWatcher::close()
+{
+	if (_descriptor >= 0) {
+		::close(_descriptor);
+	}
+
+	_descriptor = -1;
+	_path.clear();
+}
+#else
+FileWatcher::FileWatcher(const std::filesystem::path& path) : _path{ std::filesystem::absolute(path) }
+{
+	std::error_code error{};
+	_lastWrite = std::filesystem::last_write_time(_path, error);
+}
+
+bool FileWatcher::Changed()
+{
+	if (_path.empty()) {
+		return false;
+	}
+
+	// Missing while an editor replaces it, the next call sees the new file
+	std::error_code error{};
+	auto lastWrite = std::filesystem::last_write_time(_path, error);
+	if (error || lastWrite == _lastWrite) {
+		return false;
+	}
+
+	_lastWrite = lastWrite;
+	return true;
+}
+
+void FileWatcher::close()
+{
+	_path.clear();
+}
+#endif
+
+FileWatcher::~FileWatcher()
+{
+	close();
+}
+
+FileWatcher::FileWatcher(FileWatcher&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+FileWatcher& FileWatcher::operator=(FileWatcher&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		std::swap(_path, other._path);
+#ifdef __linux__
+		std::swap(_descriptor, other._descriptor);
+#else
+		std::swap(_lastWrite, other._lastWrite);
+#endif
+	}
+
+	return *this;
+}
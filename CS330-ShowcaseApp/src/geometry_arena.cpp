@@ -0,0 +1,398 @@
+#include <geometry_arena.h>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include <glm/gtc/packing.hpp>
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : _capacity{ capacity }
+{
+	if (capacity > 0) {
+		_freeBlocks.emplace(0, capacity);
+	}
+}
+
+std::optional<uint32_t> RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0) {
+		return 0;
+	}
+
+	for (auto it = _freeBlocks.begin(); it != _freeBlocks.end(); ++it) {
+		auto [offset, blockSize] = *it;
+		if (blockSize < size) {
+			continue;
+		}
+
+		_freeBlocks.erase(it);
+		if (blockSize > size) {
+			_freeBlocks.emplace(offset + size, blockSize - size);
+		}
+
+		_used += size;
+		return offset;
+	}
+
+	return std::nullopt;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	_used -= size;
+	auto next = _freeBlocks.lower_bound(offset);
+
+	// Merge with the following block
+	if (next != _freeBlocks.end() && offset + size == next->first) {
+		size += next->second;
+		next = _freeBlocks.erase(next);
+	}
+
+	// Merge with the preceding block
+	if (next != _freeBlocks.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			previous->second += size;
+			return;
+		}
+	}
+
+	_freeBlocks.emplace(offset, size);
+}
+
+void RangeAllocator::Grow(uint32_t newCapacity)
+{
+	if (newCapacity <= _capacity) {
+		return;
+	}
+
+	auto oldCapacity = _capacity;
+	_capacity = newCapacity;
+	_used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+uint32_t RangeAllocator::LargestFreeBlock() const
+{
+	uint32_t largest = 0;
+	for (auto& [offset, size] : _freeBlocks) {
+		largest = std::max(largest, size);
+	}
+
+	return largest;
+}
+
+GeometryArena& GeometryArena::Get()
+{
+	// Created on first use, when the GL context already exists
+	static GeometryArena arena{};
+	return arena;
+}
+
+uint32_t GeometryArena::PoolIndex(const GeometryRange& range)
+{
+	return static_cast<uint32_t>(range.format) * 2 + (range.indexType == GL_UNSIGNED_SHORT ? 1 : 0);
+}
+
+size_t GeometryArena::VertexSize(VertexFormat format)
+{
+	switch (format) {
+	case VertexFormat::Packed: return sizeof(PackedVertex);
+	case VertexFormat::PackedHalf: return sizeof(PackedHalfVertex);
+	default: return sizeof(Vertex);
+	}
+}
+
+GeometryArena::Pool& GeometryArena::pool(VertexFormat format, GLenum indexType)
+{
+	auto& pool = _pools[PoolIndex({ .format = format, .indexType = indexType })];
+	if (!pool.vertexArrayObject) {
+		pool.format = format;
+		pool.indexType = indexType;
+		createPool(pool);
+	}
+
+	return pool;
+}
+
+void GeometryArena::createPool(Pool& pool)
+{
+	pool.vertices = RangeAllocator{ initialVertexCapacity };
+	pool.indices = RangeAllocator{ initialIndexCapacity };
+
+	pool.vertexArrayObject = GLVertexArray::Create();
+	pool.vertexBufferObject = GLBuffer::Create();
+	pool.elementBufferObject = GLBuffer::Create();
+
+	glBindVertexArray(pool.vertexArrayObject.Get());
+
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBufferObject.Get());
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(initialVertexCapacity * VertexSize(pool.format)), nullptr, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.elementBufferObject.Get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(initialIndexCapacity * IndexSize(pool.indexType)), nullptr, GL_STATIC_DRAW);
+
+	setupVertexArray(pool);
+	setupInstanceAttributes();
+}
+
+void GeometryArena::setupInstanceAttributes()
+{
+	// Model rows take locations 4-6, the normal matrix 7-9, tint is location 10 and the material index 11.
+	// All advance once per instance.
+	for (GLuint location = 4; location <= 11; location++) {
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+}
+
+void GeometryArena::SetInstanceBuffer(GLuint buffer, GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	for (GLuint row = 0; row < 3; row++) {
+		glVertexAttribPointer(4 + row, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offset + offsetof(InstanceData, ModelRows) + row * sizeof(glm::vec4)));
+	}
+	for (GLuint column = 0; column < 3; column++) {
+		glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offset + offsetof(InstanceData, NormalMatrix) + column * sizeof(glm::vec3)));
+	}
+	glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+		(void*)(offset + offsetof(InstanceData, Tint)));
+	glVertexAttribIPointer(11, 1, GL_UNSIGNED_INT, sizeof(InstanceData),
+		(void*)(offset + offsetof(InstanceData, MaterialIndex)));
+}
+
+template <typename T>
+static void setPackedAttributes(GLenum positionType)
+{
+	// Normals are signed normalized 10 bit, the shader only reads xyz. 2_10_10_10 types need all four components.
+	glVertexAttribPointer(0, 3, positionType, GL_FALSE, sizeof(T), (void*)offsetof(T, Position));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(T), (void*)offsetof(T, Color));
+	glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(T), (void*)offsetof(T, Normal));
+	glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(T), (void*)offsetof(T, Uv));
+}
+
+void GeometryArena::setupVertexArray(const Pool& pool)
+{
+	// Expects the VAO and the vertex buffer to be bound
+	// Bind Vertex attributes [Position, Size, Type, Normalize Values (Stride in bytes and Offset)]
+	switch (pool.format) {
+	case VertexFormat::Packed:
+		setPackedAttributes<PackedVertex>(GL_FLOAT);
+		break;
+	case VertexFormat::PackedHalf:
+		setPackedAttributes<PackedHalfVertex>(GL_HALF_FLOAT);
+		break;
+	default:
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(void*)offsetof(Vertex, Position));
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(void*)offsetof(Vertex, Color));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(void*)offsetof(Vertex, Normal));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(void*)offsetof(Vertex, Uv));
+		break;
+	}
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+}
+
+template <typename T>
+static T packVertex(const Vertex& vertex)
+{
+	T packed{
+		.Normal = glm::packSnorm3x10_1x2(glm::vec4{ vertex.Normal, 0.f }),
+		.Color = glm::packUnorm4x8(vertex.Color),
+		.Uv = glm::packHalf2x16(vertex.Uv)
+	};
+
+	if constexpr (std::is_same_v<T, PackedHalfVertex>) {
+		packed.Position = glm::packHalf(glm::vec4{ vertex.Position, 1.f });
+	}
+	else {
+		packed.Position = vertex.Position;
+	}
+
+	return packed;
+}
+
+template <typename T>
+static std::vector<std::byte> packVertices(std::span<const Vertex> vertices)
+{
+	std::vector<std::byte> bytes(vertices.size() * sizeof(T));
+	auto packed = reinterpret_cast<T*>(bytes.data());
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		packed[i] = packVertex<T>(vertices[i]);
+	}
+
+	return bytes;
+}
+
+GeometryRange GeometryArena::Allocate(VertexFormat format, std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+	auto vertexCount = static_cast<uint32_t>(vertices.size());
+	auto indexCount = static_cast<uint32_t>(indices.size());
+
+	// Indices are relative to the base vertex, so the vertex count alone decides whether 16 bits are enough
+	GLenum indexType = vertexCount <= 0xffff ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	std::vector<std::byte> packed{};
+	const void* vertexData = vertices.data();
+	if (format == VertexFormat::Packed) {
+		packed = packVertices<PackedVertex>(vertices);
+		vertexData = packed.data();
+	}
+	else if (format == VertexFormat::PackedHalf) {
+		packed = packVertices<PackedHalfVertex>(vertices);
+		vertexData = packed.data();
+	}
+
+	std::vector<uint16_t> shortIndices{};
+	const void* indexData = indices.data();
+	if (indexType == GL_UNSIGNED_SHORT) {
+		shortIndices.assign(indices.begin(), indices.end());
+		indexData = shortIndices.data();
+	}
+
+	return Upload(format, indexType, vertexCount, vertexData, indexCount, indexData);
+}
+
+GeometryRange GeometryArena::Upload(VertexFormat format, GLenum indexType, uint32_t vertexCount, const void* vertices, uint32_t indexCount, const void* indices)
+{
+	auto& pool = this->pool(format, indexType);
+	auto vertexSize = VertexSize(format);
+	auto indexSize = IndexSize(indexType);
+
+	auto baseVertex = pool.vertices.Allocate(vertexCount);
+	if (!baseVertex) {
+		growVertices(pool, pool.vertices.Capacity() + vertexCount);
+		baseVertex = pool.vertices.Allocate(vertexCount);
+	}
+
+	auto firstIndex = pool.indices.Allocate(indexCount);
+	if (!firstIndex) {
+		growIndices(pool, pool.indices.Capacity() + indexCount);
+		firstIndex = pool.indices.Allocate(indexCount);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBufferObject.Get());
+	glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(*baseVertex * vertexSize),
+		static_cast<GLsizeiptr>(vertexCount * vertexSize), vertices);
+
+	// The element buffer binding is VAO state, go through the pool VAO
+	glBindVertexArray(pool.vertexArrayObject.Get());
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLintptr>(*firstIndex * indexSize),
+		static_cast<GLsizeiptr>(indexCount * indexSize), indices);
+
+	return {
+		.baseVertex = *baseVertex,
+		.vertexCount = vertexCount,
+		.firstIndex = *firstIndex,
+		.indexCount = indexCount,
+		.format = format,
+		.indexType = indexType
+	};
+}
+
+void GeometryArena::Read(const GeometryRange& range, std::vector<std::byte>& vertices, std::vector<std::byte>& indices)
+{
+	auto& pool = _pools[PoolIndex(range)];
+	auto vertexSize = VertexSize(range.format);
+	auto indexSize = IndexSize(range.indexType);
+	vertices.resize(range.vertexCount * vertexSize);
+	indices.resize(range.indexCount * indexSize);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, pool.vertexBufferObject.Get());
+	glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(range.baseVertex * vertexSize),
+		static_cast<GLsizeiptr>(vertices.size()), vertices.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, pool.elementBufferObject.Get());
+	glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(range.firstIndex * indexSize),
+		static_cast<GLsizeiptr>(indices.size()), indices.data());
+}
+
+void GeometryArena::Free(const GeometryRange& range)
+{
+	auto& pool = _pools[PoolIndex(range)];
+	pool.vertices.Free(range.baseVertex, range.vertexCount);
+	pool.indices.Free(range.firstIndex, range.indexCount);
+}
+
+void GeometryArena::Bind(const GeometryRange& range)
+{
+	glBindVertexArray(VertexArray(range));
+}
+
+GLuint GeometryArena::VertexArray(const GeometryRange& range) const
+{
+	return _pools[PoolIndex(range)].vertexArrayObject.Get();
+}
+
+uint64_t GeometryArena::UsedBytes() const
+{
+	uint64_t bytes = 0;
+	for (auto& pool : _pools) {
+		bytes += pool.vertices.Used() * VertexSize(pool.format) + pool.indices.Used() * IndexSize(pool.indexType);
+	}
+
+	return bytes;
+}
+
+void GeometryArena::Release()
+{
+	for (auto& pool : _pools) {
+		pool = Pool{};
+	}
+}
+
+// The old buffer is deleted once the new one is assigned over it
+static GLBuffer growBuffer(const GLBuffer& oldBuffer, GLsizeiptr oldSize, GLsizeiptr newSize)
+{
+	auto newBuffer = GLBuffer::Create();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer.Get());
+	glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+	// Ranges keep their offsets, so the old contents are copied over as they are
+	glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer.Get());
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+	return newBuffer;
+}
+
+void GeometryArena::growVertices(Pool& pool, uint32_t minimumCapacity)
+{
+	auto oldCapacity = pool.vertices.Capacity();
+	auto newCapacity = std::max(oldCapacity * 2, minimumCapacity);
+	auto vertexSize = VertexSize(pool.format);
+
+	pool.vertexBufferObject = growBuffer(pool.vertexBufferObject,
+		static_cast<GLsizeiptr>(oldCapacity * vertexSize), static_cast<GLsizeiptr>(newCapacity * vertexSize));
+	pool.vertices.Grow(newCapacity);
+
+	glBindVertexArray(pool.vertexArrayObject.Get());
+	glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBufferObject.Get());
+	setupVertexArray(pool);
+}
+
+void GeometryArena::growIndices(Pool& pool, uint32_t minimumCapacity)
+{
+	auto oldCapacity = pool.indices.Capacity();
+	auto newCapacity = std::max(oldCapacity * 2, minimumCapacity);
+	auto indexSize = IndexSize(pool.indexType);
+
+	pool.elementBufferObject = growBuffer(pool.elementBufferObject,
+		static_cast<GLsizeiptr>(oldCapacity * indexSize), static_cast<GLsizeiptr>(newCapacity * indexSize));
+	pool.indices.Grow(newCapacity);
+
+	glBindVertexArray(pool.vertexArrayObject.Get());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.elementBufferObject.Get());
+}
\ No newline at end of file
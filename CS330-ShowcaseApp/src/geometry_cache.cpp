@@ -0,0 +1,374 @@
+#include <geometry_cache.h>
+#include <job_system.h>
+#include <mesh_optimizer.h>
+#include <glm/gtc/constants.hpp>
+
+PrimitiveParams PrimitiveParams::Box(float width, float height, float depth, const glm::vec4& color)
+{
+	return { .type = Primitive::Box, .dimensions = { width, height, depth }, .color = { color.r, color.g, color.b, color.a } };
+}
+
+PrimitiveParams PrimitiveParams::Circle(float radius, uint32_t sectors, const glm::vec4& color)
+{
+	return { .type = Primitive::Circle, .dimensions = { radius }, .sectors = sectors, .color = { color.r, color.g, color.b, color.a } };
+}
+
+PrimitiveParams PrimitiveParams::Cylinder(float height, float topRadius, float bottomRadius, uint32_t sectors, const glm::vec4& color)
+{
+	return { .type = Primitive::Cylinder, .dimensions = { height, topRadius, bottomRadius }, .sectors = sectors, .color = { color.r, color.g, color.b, color.a } };
+}
+
+PrimitiveParams PrimitiveParams::Sphere(float radius, uint32_t stacks, uint32_t sectors, const glm::vec4& color)
+{
+	return { .type = Primitive::Sphere, .dimensions = { radius }, .stacks = stacks, .sectors = sectors, .color = { color.r, color.g, color.b, color.a } };
+}
+
+GeometryCache& GeometryCache::Get()
+{
+	static GeometryCache cache{};
+	return cache;
+}
+
+Mesh GeometryCache::Load(const PrimitiveParams& params)
+{
+	auto found = _meshes.find(params);
+	if (found != _meshes.end()) {
+		_stats.hits++;
+		return found->second;
+	}
+
+	MeshData data{};
+	generate(params, data);
+	_stats.misses++;
+	return _meshes.emplace(params, Mesh{ data.vertices, data.indices, params.format }).first->second;
+}
+
+std::vector<Mesh> GeometryCache::Load(std::span<const PrimitiveParams> params)
+{
+	// Each distinct miss is generated once
+	std::map<PrimitiveParams, size_t> missIndices{};
+	std::vector<const PrimitiveParams*> misses{};
+	for (auto& primitive : params) {
+		if (_meshes.contains(primitive)) {
+			_stats.hits++;
+			continue;
+		}
+
+		auto [miss, inserted] = missIndices.try_emplace(primitive, misses.size());
+		if (inserted) {
+			misses.push_back(&primitive);
+		}
+		else {
+			_stats.hits++;
+		}
+	}
+
+	std::vector<MeshData> generated(misses.size());
+	JobSystem::Get().ParallelFor(misses.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			generate(*misses[i], generated[i]);
+		}
+	});
+
+	for (size_t i = 0; i < misses.size(); i++) {
+		_meshes.emplace(*misses[i], Mesh{ generated[i].vertices, generated[i].indices, misses[i]->format });
+	}
+	_stats.misses += static_cast<uint32_t>(misses.size());
+
+	std::vector<Mesh> meshes{};
+	meshes.reserve(params.size());
+	for (auto& primitive : params) {
+		meshes.push_back(_meshes.at(primitive));
+	}
+
+	return meshes;
+}
+
+Mesh GeometryCache::LoadLods(const PrimitiveParams& params)
+{
+	auto found = _lods.find(params);
+	if (found == _lods.end()) {
+		auto levels = lodLevels(params);
+		if (levels.size() == 1) {
+			return Load(params);
+		}
+
+		// The levels are generated in parallel like any other batch
+		auto lods = std::make_unique<MeshLods>();
+		lods->levels = Load(levels);
+		lods->fullDetailPixels = params.sectors * LodEdgePixels / glm::pi<float>();
+		found = _lods.emplace(params, std::move(lods)).first;
+	}
+	else {
+		_stats.hits++;
+	}
+
+	Mesh mesh = found->second->levels[0];
+	mesh._lods = found->second.get();
+	return mesh;
+}
+
+void GeometryCache::Clear()
+{
+	for (auto& [params, mesh] : _meshes) {
+		mesh.Release();
+	}
+	_meshes.clear();
+	_lods.clear();
+}
+
+std::vector<PrimitiveParams> GeometryCache::lodLevels(const PrimitiveParams& params)
+{
+	std::vector<PrimitiveParams> levels{ params };
+	if (params.type == Primitive::Box) {
+		return levels;
+	}
+
+	while (levels.size() < MaxLodLevels) {
+		auto level = levels.back();
+		level.sectors /= 2;
+		if (level.type == Primitive::Sphere) {
+			level.stacks /= 2;
+			if (level.stacks < MinLodStacks) {
+				break;
+			}
+		}
+		if (level.sectors < MinLodSectors) {
+			break;
+		}
+		levels.push_back(level);
+	}
+
+	return levels;
+}
+
+void GeometryCache::generate(const PrimitiveParams& params, MeshData& data)
+{
+	switch (params.type) {
+	case Primitive::Box:
+		generateBox(params, data);
+		break;
+	case Primitive::Circle:
+		generateCircle(params, data);
+		break;
+	case Primitive::Cylinder:
+		generateCylinder(params, data);
+		break;
+	case Primitive::Sphere:
+		generateSphere(params, data);
+		break;
+	}
+
+	if (params.optimize) {
+		MeshOptimizer::Optimize(data.vertices, data.indices);
+	}
+}
+
+// Cosine and sine of the angle every sectors-th of a full turn, the last entry closes the circle
+static void sectorTable(uint32_t sectors, std::vector<glm::vec2>& table)
+{
+	float step = glm::two_pi<float>() / sectors;
+	table.resize(sectors + 1);
+	for (uint32_t i = 0; i <= sectors; i++) {
+		float angle = i * step;
+		table[i] = { glm::cos(angle), glm::sin(angle) };
+	}
+}
+
+void GeometryCache::generateBox(const PrimitiveParams& params, MeshData& data)
+{
+	struct Face {
+		glm::vec3 normal;
+		// Bit 0 picks the x side, bit 1 the y side and bit 2 the z side of the box
+		std::array<uint8_t, 4> corners;
+		std::array<glm::vec2, 4> uvs;
+		std::array<uint8_t, 6> indices;
+	};
+
+	static const std::array<Face, 6> faces{ {
+		// top
+		{ { 0.f, 1.f, 0.f }, { 2, 3, 6, 7 }, { { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 1.f, 1.f } } }, { 0, 3, 1, 0, 2, 3 } },
+		// back
+		{ { 0.f, 0.f, -1.f }, { 0, 1, 2, 3 }, { { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 1.f, 1.f } } }, { 0, 3, 1, 0, 2, 3 } },
+		// right
+		{ { 1.f, 0.f, 0.f }, { 1, 5, 3, 7 }, { { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 1.f, 1.f } } }, { 0, 3, 1, 0, 2, 3 } },
+		// front
+		{ { 0.f, 0.f, 1.f }, { 7, 6, 5, 4 }, { { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f }, { 1.f, 1.f } } }, { 0, 1, 3, 0, 3, 2 } },
+		// left
+		{ { -1.f, 0.f, 0.f }, { 0, 4, 6, 2 }, { { { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f }, { 0.f, 1.f } } }, { 0, 1, 2, 0, 2, 3 } },
+		// bottom
+		{ { 0.f, -1.f, 0.f }, { 5, 4, 1, 0 }, { { { 1.f, 1.f }, { 0.f, 1.f }, { 1.f, 0.f }, { 0.f, 0.f } } }, { 0, 1, 3, 0, 3, 2 } }
+	} };
+
+	auto [width, height, depth] = params.dimensions;
+	glm::vec3 low{ -width / 2, 0.f, -depth / 2 };
+	glm::vec3 high{ width / 2, height, depth / 2 };
+	glm::vec4 color{ params.color[0], params.color[1], params.color[2], params.color[3] };
+
+	data.vertices.resize(faces.size() * 4);
+	data.indices.resize(faces.size() * 6);
+	auto vertex = data.vertices.begin();
+	auto index = data.indices.begin();
+	for (uint32_t face = 0; face < faces.size(); face++) {
+		for (uint32_t i = 0; i < 4; i++) {
+			auto corner = faces[face].corners[i];
+			*vertex++ = {
+				.Position = { corner & 1 ? high.x : low.x, corner & 2 ? high.y : low.y, corner & 4 ? high.z : low.z },
+				.Color = color,
+				.Normal = faces[face].normal,
+				.Uv = faces[face].uvs[i]
+			};
+		}
+		for (auto faceIndex : faces[face].indices) {
+			*index++ = face * 4 + faceIndex;
+		}
+	}
+}
+
+void GeometryCache::generateCircle(const PrimitiveParams& params, MeshData& data)
+{
+	float radius = params.dimensions[0];
+	auto sectors = params.sectors;
+	glm::vec4 color{ params.color[0], params.color[1], params.color[2], params.color[3] };
+	std::vector<glm::vec2> table{};
+	sectorTable(sectors, table);
+
+	// Center, then the rim with its first vertex repeated at the end
+	data.vertices.resize(sectors + 2);
+	data.indices.resize(sectors * 3);
+	data.vertices[0] = {
+		.Position = { 0.f, 0.f, 0.f },
+		.Color = color,
+		.Normal = { 0.f, 1.f, 0.f },
+		.Uv = { 0.5f, 0.5f }
+	};
+
+	for (uint32_t i = 0; i <= sectors; i++) {
+		float cos = table[i].x;
+		float sin = table[i].y;
+		data.vertices[i + 1] = {
+			.Position = { cos * radius, 0.f, sin * radius },
+			.Color = color,
+			.Normal = { 0.f, 1.f, 0.f },
+			.Uv = { cos * 0.5f + 0.5f, sin * 0.5f + 0.5f }
+		};
+	}
+
+	for (uint32_t i = 0; i < sectors; i++) {
+		data.indices[i * 3] = i + 1;
+		data.indices[i * 3 + 1] = 0;
+		data.indices[i * 3 + 2] = i + 2;
+	}
+}
+
+void GeometryCache::generateCylinder(const PrimitiveParams& params, MeshData& data)
+{
+	auto [height, topRadius, bottomRadius] = params.dimensions;
+	auto sectors = params.sectors;
+	glm::vec4 color{ params.color[0], params.color[1], params.color[2], params.color[3] };
+	std::vector<glm::vec2> table{};
+	sectorTable(sectors, table);
+
+	// A bottom and a top vertex per sector edge, sides open
+	data.vertices.resize((sectors + 1) * 2);
+	data.indices.resize(sectors * 6);
+
+	for (uint32_t i = 0; i <= sectors; i++) {
+		float cos = table[i].x;
+		float sin = table[i].y;
+		// The texture is shifted by a sector, kept so existing textures still line up
+		float u = static_cast<float>(i + 1) / sectors;
+
+		data.vertices[i * 2] = {
+			.Position = { cos * bottomRadius, 0.f, sin * bottomRadius },
+			.Color = color,
+			.Normal = { cos, 0.f, sin },
+			.Uv = { u, 0.f }
+		};
+		data.vertices[i * 2 + 1] = {
+			.Position = { cos * topRadius, height, sin * topRadius },
+			.Color = color,
+			.Normal = { cos, 0.f, sin },
+			.Uv = { u, 1.f }
+		};
+	}
+
+	for (uint32_t i = 0; i < sectors; i++) {
+		uint32_t b0 = 2 * i,
+			t0 = 2 * i + 1,
+			b1 = 2 * i + 2,
+			t1 = 2 * i + 3;
+
+		auto index = data.indices.begin() + i * 6;
+		*index++ = b0;
+		*index++ = t1;
+		*index++ = b1;
+		*index++ = b0;
+		*index++ = t0;
+		*index++ = t1;
+	}
+}
+
+/*
+* Sphere code taken from http://www.songho.ca/opengl/gl_sphere.html
+*/
+void GeometryCache::generateSphere(const PrimitiveParams& params, MeshData& data)
+{
+	float radius = params.dimensions[0];
+	auto stacks = params.stacks;
+	auto sectors = params.sectors;
+	glm::vec4 color{ params.color[0], params.color[1], params.color[2], params.color[3] };
+	float lengthInv = 1.0f / radius;
+	float stackStep = glm::pi<float>() / stacks;
+
+	// Every stack repeats the same sector angles
+	std::vector<glm::vec2> table{};
+	sectorTable(sectors, table);
+
+	// (sectors + 1) vertices per stack, the first and last have the same position and normal but
+	// different tex coords. The first and last stack have one triangle per sector, the others two.
+	data.vertices.resize((stacks + 1) * (sectors + 1));
+	data.indices.resize(stacks > 1 ? (stacks - 1) * sectors * 6 : 0);
+
+	auto vertex = data.vertices.begin();
+	for (uint32_t i = 0; i <= stacks; ++i) {
+		float stackAngle = glm::half_pi<float>() - i * stackStep;        // starting from pi/2 to -pi/2
+		float xy = radius * glm::cos(stackAngle);             // r * cos(u)
+		float z = radius * glm::sin(stackAngle);              // r * sin(u)
+		float t = (float)i / static_cast<float>(stacks);
+
+		for (uint32_t j = 0; j <= sectors; ++j) {
+			float x = xy * table[j].x;             // r * cos(u) * cos(v)
+			float y = xy * table[j].y;             // r * cos(u) * sin(v)
+
+			*vertex++ = {
+				.Position = { x, y, z },
+				.Color = color,
+				.Normal = { x * lengthInv, y * lengthInv, z * lengthInv },
+				.Uv = { (float)j / static_cast<float>(sectors), t }
+			};
+		}
+	}
+
+	auto index = data.indices.begin();
+	for (uint32_t i = 0; i < stacks; ++i) {
+		uint32_t k1 = i * (sectors + 1);     // beginning of current stack
+		uint32_t k2 = k1 + sectors + 1;      // beginning of next stack
+
+		for (uint32_t j = 0; j < sectors; ++j, ++k1, ++k2) {
+			// k1 => k2 => k1+1
+			if (i != 0) {
+				*index++ = k1;
+				*index++ = k2;
+				*index++ = k1 + 1;
+			}
+
+			// k1+1 => k2 => k2+1
+			if (i != (stacks - 1)) {
+				*index++ = k1 + 1;
+				*index++ = k2;
+				*index++ = k2 + 1;
+			}
+		}
+	}
+}
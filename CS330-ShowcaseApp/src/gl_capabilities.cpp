@@ -0,0 +1,60 @@
+#include <gl_capabilities.h>
+#include <cstring>
+
+static GLCapabilities capabilities{};
+
+const GLCapabilities& GLCapabilities::Get()
+{
+	return capabilities;
+}
+
+static bool hasExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+	for (GLint i = 0; i < count; i++) {
+		auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && std::strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// The ARB entry points share their names with the core ones
+template <typename Fn>
+static bool loadEntryPoint(Fn& slot, GLADloadproc load, const char* name) {
+	if (!slot) {
+		slot = reinterpret_cast<Fn>(load(name));
+	}
+
+	return slot != nullptr;
+}
+
+void GLCapabilities::Detect(GLADloadproc load)
+{
+	capabilities = {};
+
+	capabilities.baseInstance = (GLAD_GL_VERSION_4_2 || hasExtension("GL_ARB_base_instance"))
+		&& loadEntryPoint(glad_glDrawElementsInstancedBaseVertexBaseInstance, load, "glDrawElementsInstancedBaseVertexBaseInstance");
+
+	// The extension alone leaves baseInstance in the commands reserved, which the instance buffer layout relies on
+	capabilities.multiDrawIndirect = capabilities.baseInstance
+		&& (GLAD_GL_VERSION_4_3 || (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_draw_indirect")))
+		&& loadEntryPoint(glad_glMultiDrawElementsIndirect, load, "glMultiDrawElementsIndirect");
+
+	capabilities.textureCompressionS3TC = hasExtension("GL_EXT_texture_compression_s3tc");
+
+	GLint binaryFormats = 0;
+	capabilities.programBinary = (GLAD_GL_VERSION_4_1 || hasExtension("GL_ARB_get_program_binary"))
+		&& loadEntryPoint(glad_glGetProgramBinary, load, "glGetProgramBinary")
+		&& loadEntryPoint(glad_glProgramBinary, load, "glProgramBinary")
+		&& loadEntryPoint(glad_glProgramParameteri, load, "glProgramParameteri");
+	if (capabilities.programBinary) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+		capabilities.programBinary = binaryFormats > 0;
+	}
+
+	capabilities.parallelShaderCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+}
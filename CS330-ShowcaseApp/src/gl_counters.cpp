@@ -0,0 +1,194 @@
+#include <gl_counters.h>
+#include <cstddef>
+#include <glad/glad.h>
+
+template <auto* Slot, typename Fn, bool IsDraw>
+struct GLHook;
+
+template <auto* Slot, typename R, typename... Args, bool IsDraw>
+struct GLHook<Slot, R(APIENTRY*)(Args...), IsDraw> {
+	static inline R(APIENTRY* real)(Args...) = nullptr;
+
+	static R APIENTRY Call(Args... args) {
+		GLCounters::_values.glCalls++;
+		if constexpr (IsDraw) {
+			GLCounters::_values.drawCalls++;
+		}
+		return real(args...);
+	}
+
+	static void Install() {
+		if (*Slot && *Slot != &Call) {
+			real = *Slot;
+			*Slot = &Call;
+		}
+	}
+};
+
+#define COUNT_GL_CALL(name) GLHook<&glad_##name, decltype(glad_##name), false>::Install()
+#define COUNT_GL_DRAW(name) GLHook<&glad_##name, decltype(glad_##name), true>::Install()
+
+static size_t bytesPerPixel(GLenum format, GLenum type) {
+	size_t components = 4;
+	switch (format) {
+	case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: components = 1; break;
+	case GL_RG: case GL_RG_INTEGER: components = 2; break;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+	default: break;
+	}
+
+	switch (type) {
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+	case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: return components * 4;
+	default: return components;
+	}
+}
+
+// Uploads need their arguments inspected, so they are wrapped by hand
+struct GLUploadHooks {
+	static inline PFNGLBINDBUFFERPROC bindBuffer = nullptr;
+	static inline PFNGLBUFFERDATAPROC bufferData = nullptr;
+	static inline PFNGLBUFFERSUBDATAPROC bufferSubData = nullptr;
+	static inline PFNGLTEXIMAGE2DPROC texImage2D = nullptr;
+	static inline PFNGLTEXSUBIMAGE2DPROC texSubImage2D = nullptr;
+	static inline PFNGLTEXIMAGE3DPROC texImage3D = nullptr;
+	static inline PFNGLTEXSUBIMAGE3DPROC texSubImage3D = nullptr;
+	static inline PFNGLCOMPRESSEDTEXIMAGE2DPROC compressedTexImage2D = nullptr;
+	static inline PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC compressedTexSubImage3D = nullptr;
+
+	// Texture uploads sourced from a pixel unpack buffer were already counted when the buffer was filled
+	static inline GLuint unpackBuffer = 0;
+
+	static void count(uint64_t bytes = 0) {
+		GLCounters::_values.glCalls++;
+		GLCounters::_values.bytesUploaded += bytes;
+	}
+
+	static void countPixels(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+		count(pixels && !unpackBuffer ? bytesPerPixel(format, type) * width * height * depth : 0);
+	}
+
+	static void APIENTRY BindBuffer(GLenum target, GLuint buffer) {
+		count();
+		if (target == GL_PIXEL_UNPACK_BUFFER) {
+			unpackBuffer = buffer;
+		}
+		bindBuffer(target, buffer);
+	}
+
+	static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		count(data ? size : 0);
+		bufferData(target, size, data, usage);
+	}
+
+	static void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		count(size);
+		bufferSubData(target, offset, size, data);
+	}
+
+	static void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+		countPixels(width, height, 1, format, type, pixels);
+		texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+	}
+
+	static void APIENTRY TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+		countPixels(width, height, 1, format, type, pixels);
+		texSubImage2D(target, level, x, y, width, height, format, type, pixels);
+	}
+
+	static void APIENTRY TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+		countPixels(width, height, depth, format, type, pixels);
+		texImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+	}
+
+	static void APIENTRY TexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+		countPixels(width, height, depth, format, type, pixels);
+		texSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+	}
+
+	static void APIENTRY CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) {
+		count(data && !unpackBuffer ? imageSize : 0);
+		compressedTexImage2D(target, level, internalFormat, width, height, border, imageSize, data);
+	}
+
+	static void APIENTRY CompressedTexSubImage3D(GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data) {
+		count(data && !unpackBuffer ? imageSize : 0);
+		compressedTexSubImage3D(target, level, x, y, z, width, height, depth, format, imageSize, data);
+	}
+};
+
+template <typename Fn>
+static void hookUpload(Fn& slot, Fn& real, Fn wrapper) {
+	if (slot && slot != wrapper) {
+		real = slot;
+		slot = wrapper;
+	}
+}
+
+void GLCounters::Install() {
+	hookUpload(glad_glBindBuffer, GLUploadHooks::bindBuffer, &GLUploadHooks::BindBuffer);
+	hookUpload(glad_glBufferData, GLUploadHooks::bufferData, &GLUploadHooks::BufferData);
+	hookUpload(glad_glBufferSubData, GLUploadHooks::bufferSubData, &GLUploadHooks::BufferSubData);
+	hookUpload(glad_glTexImage2D, GLUploadHooks::texImage2D, &GLUploadHooks::TexImage2D);
+	hookUpload(glad_glTexSubImage2D, GLUploadHooks::texSubImage2D, &GLUploadHooks::TexSubImage2D);
+	hookUpload(glad_glTexImage3D, GLUploadHooks::texImage3D, &GLUploadHooks::TexImage3D);
+	hookUpload(glad_glTexSubImage3D, GLUploadHooks::texSubImage3D, &GLUploadHooks::TexSubImage3D);
+	hookUpload(glad_glCompressedTexImage2D, GLUploadHooks::compressedTexImage2D, &GLUploadHooks::CompressedTexImage2D);
+	hookUpload(glad_glCompressedTexSubImage3D, GLUploadHooks::compressedTexSubImage3D, &GLUploadHooks::CompressedTexSubImage3D);
+
+	COUNT_GL_DRAW(glDrawArrays);
+	COUNT_GL_DRAW(glDrawElements);
+	COUNT_GL_DRAW(glDrawElementsBaseVertex);
+	COUNT_GL_DRAW(glDrawElementsInstanced);
+	COUNT_GL_DRAW(glDrawElementsInstancedBaseVertex);
+	COUNT_GL_DRAW(glDrawElementsInstancedBaseVertexBaseInstance);
+	COUNT_GL_DRAW(glMultiDrawElements);
+	COUNT_GL_DRAW(glMultiDrawElementsBaseVertex);
+	COUNT_GL_DRAW(glMultiDrawElementsIndirect);
+
+	COUNT_GL_CALL(glClear);
+	COUNT_GL_CALL(glClearColor);
+	COUNT_GL_CALL(glViewport);
+	COUNT_GL_CALL(glEnable);
+	COUNT_GL_CALL(glDisable);
+	COUNT_GL_CALL(glBlendFunc);
+	COUNT_GL_CALL(glDepthMask);
+	COUNT_GL_CALL(glCullFace);
+	COUNT_GL_CALL(glUseProgram);
+	COUNT_GL_CALL(glBindVertexArray);
+	COUNT_GL_CALL(glBindBufferBase);
+	COUNT_GL_CALL(glBindBufferRange);
+	COUNT_GL_CALL(glMapBufferRange);
+	COUNT_GL_CALL(glCopyBufferSubData);
+	COUNT_GL_CALL(glUnmapBuffer);
+	COUNT_GL_CALL(glActiveTexture);
+	COUNT_GL_CALL(glBindTexture);
+	COUNT_GL_CALL(glTexParameteri);
+	COUNT_GL_CALL(glGenerateMipmap);
+	COUNT_GL_CALL(glCompressedTexImage3D);
+	COUNT_GL_CALL(glGetTexImage);
+	COUNT_GL_CALL(glGetCompressedTexImage);
+	COUNT_GL_CALL(glGetUniformLocation);
+	COUNT_GL_CALL(glGetUniformBlockIndex);
+	COUNT_GL_CALL(glUniformBlockBinding);
+	COUNT_GL_CALL(glUniform1i);
+	COUNT_GL_CALL(glUniform1f);
+	COUNT_GL_CALL(glUniform3fv);
+	COUNT_GL_CALL(glUniform4fv);
+	COUNT_GL_CALL(glUniformMatrix3fv);
+	COUNT_GL_CALL(glUniformMatrix4fv);
+	COUNT_GL_CALL(glVertexAttribPointer);
+	COUNT_GL_CALL(glVertexAttribIPointer);
+	COUNT_GL_CALL(glVertexAttribDivisor);
+	COUNT_GL_CALL(glEnableVertexAttribArray);
+	COUNT_GL_CALL(glGenBuffers);
+	COUNT_GL_CALL(glGenVertexArrays);
+	COUNT_GL_CALL(glGenTextures);
+	COUNT_GL_CALL(glDeleteBuffers);
+	COUNT_GL_CALL(glDeleteVertexArrays);
+	COUNT_GL_CALL(glDeleteTextures);
+	COUNT_GL_CALL(glDeleteProgram);
+	COUNT_GL_CALL(glFenceSync);
+	COUNT_GL_CALL(glClientWaitSync);
+	COUNT_GL_CALL(glDeleteSync);
+}
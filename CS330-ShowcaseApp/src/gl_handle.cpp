@@ -0,0 +1,138 @@
+#include <gl_handle.h>
+#include <array>
+#include <atomic>
+#include <ostream>
+
+#ifndef NDEBUG
+#include <mutex>
+#include <set>
+#endif
+
+static constexpr size_t TypeCount = static_cast<size_t>(GLObjectType::Count);
+static constexpr std::array<const char*, TypeCount> TypeNames{ "buffer", "vertex array", "texture", "program", "framebuffer", "renderbuffer" };
+
+static std::array<std::atomic<size_t>, TypeCount> liveCounts{};
+
+#ifndef NDEBUG
+static std::mutex liveMutex{};
+static std::array<std::set<GLuint>, TypeCount> liveNames{};
+#endif
+
+void GLLeakTracker::Created(GLObjectType type, [[maybe_unused]] GLuint name)
+{
+	auto index = static_cast<size_t>(type);
+	liveCounts[index]++;
+#ifndef NDEBUG
+	std::lock_guard lock{ liveMutex };
+	liveNames[index].insert(name);
+#endif
+}
+
+void GLLeakTracker::Destroyed(GLObjectType type, [[maybe_unused]] GLuint name)
+{
+	auto index = static_cast<size_t>(type);
+	liveCounts[index]--;
+#ifndef NDEBUG
+	std::lock_guard lock{ liveMutex };
+	liveNames[index].erase(name);
+#endif
+}
+
+size_t GLLeakTracker::Live(GLObjectType type)
+{
+	return liveCounts[static_cast<size_t>(type)];
+}
+
+size_t GLLeakTracker::Live()
+{
+	size_t live = 0;
+	for (auto& count : liveCounts) {
+		live += count;
+	}
+	return live;
+}
+
+size_t GLLeakTracker::Report(std::ostream& out)
+{
+	auto live = Live();
+	if (live == 0) {
+		return 0;
+	}
+
+	out << "GL objects still alive: " << live << std::endl;
+	for (size_t i = 0; i < TypeCount; i++) {
+		if (liveCounts[i] == 0) {
+			continue;
+		}
+
+		out << "  " << TypeNames[i] << ": " << liveCounts[i];
+#ifndef NDEBUG
+		std::lock_guard lock{ liveMutex };
+		out << " (";
+		bool first = true;
+		for (auto name : liveNames[i]) {
+			out << (first ? "" : " ") << name;
+			first = false;
+		}
+		out << ")";
+#endif
+		out << std::endl;
+	}
+
+	return live;
+}
+
+GLuint CreateGLObject(GLObjectType type)
+{
+	GLuint name = 0;
+	switch (type) {
+	case GLObjectType::Buffer:
+		glGenBuffers(1, &name);
+		break;
+	case GLObjectType::VertexArray:
+		glGenVertexArrays(1, &name);
+		break;
+	case GLObjectType::Texture:
+		glGenTextures(1, &name);
+		break;
+	case GLObjectType::Program:
+		name = glCreateProgram();
+		break;
+	case GLObjectType::Framebuffer:
+		glGenFramebuffers(1, &name);
+		break;
+	case GLObjectType::Renderbuffer:
+		glGenRenderbuffers(1, &name);
+		break;
+	default:
+		break;
+	}
+
+	return name;
+}
+
+void DeleteGLObject(GLObjectType type, GLuint name)
+{
+	switch (type) {
+	case GLObjectType::Buffer:
+		glDeleteBuffers(1, &name);
+		break;
+	case GLObjectType::VertexArray:
+		glDeleteVertexArrays(1, &name);
+		break;
+	case GLObjectType::Texture:
+		glDeleteTextures(1, &name);
+		break;
+	case GLObjectType::Program:
+		glDeleteProgram(name);
+		break;
+	case GLObjectType::Framebuffer:
+		glDeleteFramebuffers(1, &name);
+		break;
+	case GLObjectType::Renderbuffer:
+		glDeleteRenderbuffers(1, &name);
+		break;
+	default:
+		break;
+	}
+}
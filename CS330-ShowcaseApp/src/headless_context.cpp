@@ -0,0 +1,153 @@
+#include <headless_context.h>
+#include <gl_capabilities.h>
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height) : _width{ width }, _height{ height }
+{
+	if (!createContext()) {
+		return;
+	}
+
+	createFramebuffer();
+	_valid = true;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	// Members would only be destroyed after the context below
+	_framebuffer.Reset();
+	_colorBuffer.Reset();
+	_depthBuffer.Reset();
+
+#ifdef __linux__
+	if (_display) {
+		eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (_context) {
+			eglDestroyContext(_display, _context);
+		}
+		eglTerminate(_display);
+	}
+#else
+	if (_context) {
+		glfwDestroyWindow(reinterpret_cast<GLFWwindow*>(_context));
+		glfwTerminate();
+	}
+#endif
+}
+
+void HeadlessContext::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer.Get());
+	glViewport(0, 0, _width, _height);
+}
+
+std::vector<uint8_t> HeadlessContext::ReadPixels()
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(_width) * _height * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer.Get());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	return pixels;
+}
+
+#ifdef __linux__
+bool HeadlessContext::createContext()
+{
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	EGLDisplay display = getPlatformDisplay
+		? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+		: eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::cerr << "Failed to initialize EGL display" << std::endl;
+		return false;
+	}
+	_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cerr << "EGL display does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// Surfaceless contexts do not need a config, everything is drawn into our own framebuffer
+	_context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (_context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context)) {
+		std::cerr << "Failed to create surfaceless EGL context" << std::endl;
+		return false;
+	}
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+	GLCapabilities::Detect((GLADloadproc)eglGetProcAddress);
+
+	return true;
+}
+#else
+bool HeadlessContext::createContext()
+{
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	auto window = glfwCreateWindow(_width, _height, "showcase_bench", nullptr, nullptr);
+	if (!window) {
+		std::cerr << "Failed to create hidden GLFW window" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	_context = window;
+
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+	GLCapabilities::Detect((GLADloadproc)glfwGetProcAddress);
+
+	return true;
+}
+#endif
+
+void HeadlessContext::createFramebuffer()
+{
+	_colorBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer.Get());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+
+	_depthBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer.Get());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+
+	_framebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer.Get());
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+	}
+
+	Bind();
+}
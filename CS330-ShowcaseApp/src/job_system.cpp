@@ -0,0 +1,366 @@
+#include <job_system.h>
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+static thread_local uint32_t workerIndex = 0;
+// Jobs that wait run other jobs inside their own, only the outermost one is timed
+static thread_local bool runningJob = false;
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem jobs{};
+	return jobs;
+}
+
+JobSystem::JobSystem()
+{
+	_workers.push_back(std::make_unique<Worker>());
+}
+
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+void JobSystem::Start(uint32_t threadCount)
+{
+	Stop();
+
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	workerIndex = 0;
+	_workers.clear();
+	for (uint32_t i = 0; i < threadCount; i++) {
+		_workers.push_back(std::make_unique<Worker>());
+		// Room for the ranges of a ParallelFor and then some, so queues do not grow mid frame
+		_workers.back()->jobs.Reserve(threadCount * 8);
+	}
+
+	// Every worker exists before the first thread starts stealing from them
+	_running = true;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		_workers[i]->thread = std::thread{ &JobSystem::workerLoop, this, i };
+	}
+	ResetStats();
+}
+
+void JobSystem::Stop()
+{
+	{
+		std::lock_guard lock{ _sleepMutex };
+		_running = false;
+	}
+	_wake.notify_all();
+
+	for (auto& worker : _workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+
+	// Jobs left in the queues of stopped threads still run, on the caller's next wait
+	for (size_t i = 1; i < _workers.size(); i++) {
+		while (!_workers[i]->jobs.Empty()) {
+			_workers[0]->jobs.PushBack(_workers[i]->jobs.PopFront());
+		}
+	}
+}
+
+uint32_t JobSystem::WorkerIndex()
+{
+	return workerIndex;
+}
+
+JobHandle JobSystem::Schedule(std::function<void()> work, std::span<const JobHandle> dependencies)
+{
+	auto job = makeJob();
+	job->_work = std::move(work);
+
+	for (auto& dependency : dependencies) {
+		if (!dependency) {
+			continue;
+		}
+
+		std::lock_guard lock{ dependency->_mutex };
+		if (!dependency->IsFinished()) {
+			job->_pending++;
+			if (dependency->_dependentCount < dependency->_dependents.size()) {
+				dependency->_dependents[dependency->_dependentCount++] = job;
+			}
+			else {
+				dependency->_moreDependents.push_back(job);
+			}
+		}
+	}
+
+	if (--job->_pending == 0) {
+		enqueue(job);
+	}
+
+	return job;
+}
+
+JobHandle JobSystem::ScheduleParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> work, std::span<const JobHandle> dependencies)
+{
+	// A few ranges per thread leave room for stealing when ranges take uneven time
+	grainSize = std::max<size_t>(grainSize, 1);
+	size_t ranges = std::min((count + grainSize - 1) / grainSize, static_cast<size_t>(ThreadCount()) * 4);
+	if (ranges <= 1) {
+		return Schedule([work = std::move(work), count] { work(0, count); }, dependencies);
+	}
+
+	auto shared = std::make_shared<std::function<void(size_t, size_t)>>(std::move(work));
+	std::vector<JobHandle> parts{};
+	parts.reserve(ranges);
+	size_t rangeSize = (count + ranges - 1) / ranges;
+	for (size_t begin = 0; begin < count; begin += rangeSize) {
+		size_t end = std::min(begin + rangeSize, count);
+		parts.push_back(Schedule([shared, begin, end] { (*shared)(begin, end); }, dependencies));
+	}
+
+	return Schedule([] {}, parts);
+}
+
+void JobSystem::Wait(const JobHandle& job)
+{
+	if (!job) {
+		return;
+	}
+
+	auto index = WorkerIndex();
+	while (!job->IsFinished()) {
+		if (auto next = findJob(index)) {
+			run(next, index);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize, void (*function)(void* context, size_t begin, size_t end), void* context)
+{
+	if (count == 0) {
+		return;
+	}
+
+	if (ThreadCount() == 1 || count <= grainSize) {
+		// Counted like a job so a single thread still reports how busy it was
+		auto start = std::chrono::steady_clock::now();
+		function(context, 0, count);
+		if (!runningJob) {
+			auto& worker = *_workers[std::min(WorkerIndex(), ThreadCount() - 1)];
+			worker.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			worker.jobCount++;
+		}
+		return;
+	}
+
+	// Split like ScheduleParallelFor, but the ranges count down on this stack instead of a join job
+	grainSize = std::max<size_t>(grainSize, 1);
+	size_t ranges = std::min((count + grainSize - 1) / grainSize, static_cast<size_t>(ThreadCount()) * 4);
+	size_t rangeSize = (count + ranges - 1) / ranges;
+	JobRanges work{ function, context, (count + rangeSize - 1) / rangeSize };
+	for (size_t begin = 0; begin < count; begin += rangeSize) {
+		auto job = makeJob();
+		job->_ranges = &work;
+		job->_begin = begin;
+		job->_end = std::min(begin + rangeSize, count);
+		job->_pending = 0;
+		enqueue(std::move(job));
+	}
+
+	auto index = WorkerIndex();
+	while (work.remaining.load(std::memory_order_acquire) > 0) {
+		if (auto next = findJob(index)) {
+			run(next, index);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+std::vector<WorkerStats> JobSystem::Stats() const
+{
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _statsStart).count();
+
+	std::vector<WorkerStats> stats{};
+	for (auto& worker : _workers) {
+		double busyMs = worker->busyNanoseconds / 1e6;
+		stats.push_back({
+			.busyMs = busyMs,
+			.utilization = elapsedMs > 0.0 ? busyMs / elapsedMs : 0.0,
+			.jobs = worker->jobCount,
+			.steals = worker->steals
+		});
+	}
+
+	return stats;
+}
+
+void JobSystem::ResetStats()
+{
+	for (auto& worker : _workers) {
+		worker->busyNanoseconds = 0;
+		worker->jobCount = 0;
+		worker->steals = 0;
+	}
+	_statsStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::JobQueue::Reserve(size_t capacity)
+{
+	if (capacity <= _jobs.size()) {
+		return;
+	}
+
+	// Power of two sizes, so indices wrap with a mask
+	std::vector<JobHandle> jobs(std::bit_ceil(capacity));
+	for (size_t i = 0; i < _count; i++) {
+		jobs[i] = std::move((*this)[i]);
+	}
+	_jobs.swap(jobs);
+	_head = 0;
+}
+
+void JobSystem::JobQueue::PushBack(JobHandle job)
+{
+	if (_count == _jobs.size()) {
+		Reserve(std::max<size_t>(_jobs.size() * 2, 16));
+	}
+
+	(*this)[_count++] = std::move(job);
+}
+
+JobHandle JobSystem::JobQueue::PopBack()
+{
+	return std::move((*this)[--_count]);
+}
+
+JobHandle JobSystem::JobQueue::PopFront()
+{
+	auto job = std::move(_jobs[_head]);
+	_head = (_head + 1) & (_jobs.size() - 1);
+	_count--;
+	return job;
+}
+
+JobHandle JobSystem::makeJob()
+{
+	return std::allocate_shared<Job>(JobAllocator<Job>{});
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+	workerIndex = index;
+
+	while (true) {
+		if (auto job = findJob(index)) {
+			run(job, index);
+			continue;
+		}
+
+		std::unique_lock lock{ _sleepMutex };
+		_wake.wait(lock, [this] { return !_running || _queued > 0; });
+		if (!_running) {
+			return;
+		}
+	}
+}
+
+void JobSystem::enqueue(JobHandle job)
+{
+	// Counted under the sleep mutex so a worker cannot check, miss it and then sleep through the
+	// notify. Counting before the push keeps the count from dropping below zero when a thief is fast.
+	{
+		std::lock_guard lock{ _sleepMutex };
+		_queued++;
+	}
+
+	// Threads outside the pool hand their jobs to worker 0
+	auto& worker = *_workers[std::min(WorkerIndex(), ThreadCount() - 1)];
+	{
+		std::lock_guard lock{ worker.mutex };
+		worker.jobs.PushBack(std::move(job));
+	}
+	_wake.notify_one();
+}
+
+JobHandle JobSystem::findJob(uint32_t index)
+{
+	auto& own = *_workers[index];
+	{
+		std::lock_guard lock{ own.mutex };
+		if (!own.jobs.Empty()) {
+			auto job = own.jobs.PopBack();
+			_queued--;
+			return job;
+		}
+	}
+
+	for (uint32_t offset = 1; offset < ThreadCount(); offset++) {
+		auto& victim = *_workers[(index + offset) % ThreadCount()];
+		std::lock_guard lock{ victim.mutex };
+		if (!victim.jobs.Empty()) {
+			auto job = victim.jobs.PopFront();
+			_queued--;
+			own.steals++;
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void JobSystem::run(const JobHandle& job, uint32_t index)
+{
+	auto& worker = *_workers[index];
+	bool outermost = !std::exchange(runningJob, true);
+	auto start = std::chrono::steady_clock::now();
+	if (job->_ranges) {
+		job->_ranges->function(job->_ranges->context, job->_begin, job->_end);
+	}
+	else {
+		job->_work();
+	}
+	if (outermost) {
+		worker.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		runningJob = false;
+	}
+	worker.jobCount++;
+
+	finish(job);
+}
+
+void JobSystem::finish(const JobHandle& job)
+{
+	// Captures go before waiters can see the job finished, they may point into the waiter's stack
+	job->_work = nullptr;
+
+	std::array<JobHandle, 4> dependents{};
+	uint32_t dependentCount = 0;
+	std::vector<JobHandle> moreDependents{};
+	{
+		std::lock_guard lock{ job->_mutex };
+		job->_finished.store(true, std::memory_order_release);
+		dependentCount = std::exchange(job->_dependentCount, 0);
+		std::move(job->_dependents.begin(), job->_dependents.begin() + dependentCount, dependents.begin());
+		moreDependents.swap(job->_moreDependents);
+	}
+	auto release = [this](JobHandle& dependent) {
+		if (--dependent->_pending == 0) {
+			enqueue(std::move(dependent));
+		}
+	};
+	std::for_each(dependents.begin(), dependents.begin() + dependentCount, release);
+	std::for_each(moreDependents.begin(), moreDependents.end(), release);
+
+	// Last, the waiting thread may return and take the ranges with its stack
+	if (auto ranges = std::exchange(job->_ranges, nullptr)) {
+		ranges->remaining.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -1,10 +1,25 @@
 #include <iostream>
+#include <string>
 #include <application.h>
 
 int main(int argc, char** argv) {
 	Application app{ "CS33-ShowcaseApp", 800, 600 };
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--description" && i + 1 < argc) {
+			app.SetSceneDescription(argv[++i]);
+		}
+		else if (argument == "--scene" && i + 1 < argc) {
+			app.SetSceneFile(argv[++i]);
+		}
+		else {
+			std::cerr << "Usage: CS330-ShowcaseApp [--description scene.txt] [--scene file.scene]" << std::endl;
+			return 1;
+		}
+	}
 	
 	app.Run();
 
 	return 0;
-}
\ No newline at end of file
+}
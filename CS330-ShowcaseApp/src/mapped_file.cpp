@@ -0,0 +1,115 @@
+#include <mapped_file.h>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE) {
+		_file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+		close();
+		return;
+	}
+
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping) {
+		close();
+		return;
+	}
+
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	_size = _data ? static_cast<size_t>(size.QuadPart) : 0;
+	if (!_data) {
+		close();
+	}
+}
+
+void MappedFile::close()
+{
+	if (_data) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping) {
+		CloseHandle(_mapping);
+	}
+	if (_file) {
+		CloseHandle(_file);
+	}
+
+	_data = nullptr;
+	_size = 0;
+	_mapping = nullptr;
+	_file = nullptr;
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return;
+	}
+
+	struct stat status {};
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			_data = static_cast<const uint8_t*>(data);
+			_size = static_cast<size_t>(status.st_size);
+		}
+	}
+
+	// The mapping keeps the file alive on its own
+	::close(file);
+}
+
+void MappedFile::close()
+{
+	if (_data) {
+		munmap(const_cast<uint8_t*>(_data), _size);
+	}
+
+	_data = nullptr;
+	_size = 0;
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		std::swap(_data, other._data);
+		std::swap(_size, other._size);
+#ifdef _WIN32
+		std::swap(_file, other._file);
+		std::swap(_mapping, other._mapping);
+#endif
+	}
+
+	return *this;
+}
@@ -6,7 +6,10 @@ Material::Material(
 	glm::vec3 diffuse,
 	glm::vec3 specular
 ) : _texture{ texture }, _ambient{ ambient }, _diffuse{ diffuse }, _specular{ specular }
-{}
+{
+	static uint32_t nextId = 0;
+	_id = nextId++;
+}
 
 Material::Material(std::shared_ptr<Texture> texture) : Material(
 	texture,
@@ -16,12 +19,13 @@ Material::Material(std::shared_ptr<Texture> texture) : Material(
 )
 {}
 
-void Material::Bind(Shader shader)
+MaterialGPU Material::GPU() const
 {
-	shader.Bind();
-	_texture->Bind();
-	shader.SetVec3("material.ambient", _ambient);
-	shader.SetVec3("material.diffuse", _diffuse);
-	shader.SetVec3("material.specular", _specular);
-	shader.SetFloat("material.shininess", shininess);
+	return {
+		.diffuse = _diffuse,
+		.shininess = shininess,
+		.specular = _specular,
+		.layer = static_cast<int32_t>(_texture->Layer()),
+		.uvRect = _texture->UvRect()
+	};
 }
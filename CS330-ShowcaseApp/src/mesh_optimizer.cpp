@@ -0,0 +1,290 @@
+#include <mesh_optimizer.h>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <glm/glm.hpp>
+
+MeshOptimizerReport MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	MeshOptimizerReport report{ .vertices = static_cast<uint32_t>(vertices.size()), .triangles = static_cast<uint32_t>(indices.size() / 3) };
+	if (indices.empty() || indices.size() % 3 != 0) {
+		return report;
+	}
+
+	report.before = Analyze(indices, vertices.size());
+	auto original = indices;
+	auto clusters = OptimizeVertexCache(indices, vertices.size());
+	report.clusters = OptimizeOverdraw(indices, vertices, clusters);
+	// Small meshes that are already strips can come out worse, they keep their order
+	if (Analyze(indices, vertices.size()).acmr > report.before.acmr) {
+		indices = std::move(original);
+		report.clusters = 1;
+	}
+	OptimizeVertexFetch(vertices, indices);
+	report.after = Analyze(indices, vertices.size());
+
+	std::lock_guard lock{ _reportMutex };
+	if (_recording) {
+		_reports.push_back(report);
+	}
+	return report;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// Triangles around each vertex, packed by vertex
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (auto vertex : indices) {
+		live[vertex]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+		}
+	}
+
+	// A vertex is in the cache while fewer than CacheSize vertices were transformed after it
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	uint32_t time = CacheSize + 1;
+	auto inCache = [&](uint32_t vertex) { return time - cachedAt[vertex] <= CacheSize; };
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output{};
+	output.reserve(indices.size());
+	std::vector<uint32_t> deadEnds{};
+	deadEnds.reserve(indices.size());
+	std::vector<uint32_t> candidates{};
+	std::vector<uint32_t> clusters{};
+	uint32_t cursor = 0;
+
+	// Most recent vertex with triangles left, else the first one in index order. Starting over
+	// from a vertex that left the cache is where a new cluster begins.
+	auto skipDeadEnd = [&]() -> int64_t {
+		while (!deadEnds.empty()) {
+			auto vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex] > 0) {
+				if (!inCache(vertex)) {
+					clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+				}
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; cursor++) {
+			if (live[cursor] > 0) {
+				clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+				return cursor;
+			}
+		}
+		return -1;
+	};
+
+	int64_t fan = skipDeadEnd();
+	while (fan >= 0) {
+		// Emit every triangle left around the fanning vertex
+		candidates.clear();
+		for (auto i = offsets[fan]; i < offsets[fan + 1]; i++) {
+			auto triangle = adjacency[i];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = 1;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				auto vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (!inCache(vertex)) {
+					cachedAt[vertex] = time++;
+				}
+			}
+		}
+
+		// Next is the oldest candidate that is still cached after its own triangles are emitted
+		int64_t next = -1;
+		int64_t best = -1;
+		for (auto vertex : candidates) {
+			if (live[vertex] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cachedAt[vertex] + 2 * live[vertex] <= CacheSize) {
+				priority = time - cachedAt[vertex];
+			}
+			if (priority > best) {
+				best = priority;
+				next = vertex;
+			}
+		}
+
+		fan = next >= 0 ? next : skipDeadEnd();
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin());
+	return clusters;
+}
+
+uint32_t MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, std::span<const uint32_t> clusters)
+{
+	size_t triangleCount = indices.size() / 3;
+	float meshAcmr = Analyze(indices, vertices.size()).acmr;
+
+	// Soft boundaries: a cluster ends as soon as it alone has an ACMR close to the mesh's
+	std::vector<uint32_t> starts{};
+	std::vector<uint32_t> cachedAt(vertices.size(), 0);
+	uint32_t time = CacheSize + 1;
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+		uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : static_cast<uint32_t>(triangleCount);
+		uint32_t start = clusters[cluster];
+		uint32_t misses = 0;
+		time += CacheSize + 1;
+		starts.push_back(start);
+
+		for (uint32_t triangle = start; triangle < end; triangle++) {
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				auto vertex = indices[triangle * 3 + corner];
+				if (time - cachedAt[vertex] > CacheSize) {
+					cachedAt[vertex] = time++;
+					misses++;
+				}
+			}
+
+			if (triangle + 1 < end && misses <= ClusterThreshold * meshAcmr * (triangle + 1 - start)) {
+				starts.push_back(triangle + 1);
+				start = triangle + 1;
+				misses = 0;
+				time += CacheSize + 1;
+			}
+		}
+	}
+
+	// Mesh center weighted by area, clusters facing away from it are likely in front of the rest
+	auto triangleCenter = [&](size_t triangle) {
+		return (vertices[indices[triangle * 3]].Position + vertices[indices[triangle * 3 + 1]].Position + vertices[indices[triangle * 3 + 2]].Position) / 3.f;
+	};
+	auto triangleNormal = [&](size_t triangle) {
+		auto& a = vertices[indices[triangle * 3]].Position;
+		return glm::cross(vertices[indices[triangle * 3 + 1]].Position - a, vertices[indices[triangle * 3 + 2]].Position - a);
+	};
+
+	glm::vec3 meshCenter{};
+	float meshArea = 0.f;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+		float area = glm::length(triangleNormal(triangle));
+		meshCenter += triangleCenter(triangle) * area;
+		meshArea += area;
+	}
+	if (meshArea > 0.f) {
+		meshCenter /= meshArea;
+	}
+
+	struct Cluster {
+		uint32_t start;
+		uint32_t end;
+		float facing;
+	};
+	std::vector<Cluster> sorted(starts.size());
+	for (size_t i = 0; i < starts.size(); i++) {
+		uint32_t end = i + 1 < starts.size() ? starts[i + 1] : static_cast<uint32_t>(triangleCount);
+		glm::vec3 center{};
+		glm::vec3 normal{};
+		float area = 0.f;
+		for (uint32_t triangle = starts[i]; triangle < end; triangle++) {
+			auto triangleArea = glm::length(triangleNormal(triangle));
+			center += triangleCenter(triangle) * triangleArea;
+			normal += triangleNormal(triangle);
+			area += triangleArea;
+		}
+
+		float facing = 0.f;
+		if (area > 0.f && glm::length(normal) > 0.f) {
+			facing = glm::dot(center / area - meshCenter, glm::normalize(normal));
+		}
+		sorted[i] = { starts[i], end, facing };
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.facing > b.facing; });
+
+	std::vector<uint32_t> output{};
+	output.reserve(indices.size());
+	for (auto& cluster : sorted) {
+		output.insert(output.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+	}
+	std::copy(output.begin(), output.end(), indices.begin());
+
+	return static_cast<uint32_t>(sorted.size());
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+{
+	constexpr uint32_t Unused = UINT32_MAX;
+	std::vector<uint32_t> remap(vertices.size(), Unused);
+	std::vector<Vertex> reordered{};
+	reordered.reserve(vertices.size());
+
+	for (auto& index : indices) {
+		if (remap[index] == Unused) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(reordered);
+}
+
+VertexCacheStats MeshOptimizer::Analyze(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	uint32_t referenced = 0;
+
+	for (auto vertex : indices) {
+		if (time - cachedAt[vertex] > cacheSize) {
+			cachedAt[vertex] = time++;
+			misses++;
+		}
+		if (!used[vertex]) {
+			used[vertex] = 1;
+			referenced++;
+		}
+	}
+
+	auto triangles = indices.size() / 3;
+	return {
+		.acmr = triangles ? static_cast<float>(misses) / triangles : 0.f,
+		.atvr = referenced ? static_cast<float>(misses) / referenced : 0.f
+	};
+}
+
+void MeshOptimizer::RecordReports(bool record)
+{
+	std::lock_guard lock{ _reportMutex };
+	_recording = record;
+}
+
+std::vector<MeshOptimizerReport> MeshOptimizer::Reports()
+{
+	std::unique_lock lock{ _reportMutex };
+	auto reports = _reports;
+	lock.unlock();
+
+	// Workers finish in any order, sorted the list is the same for every thread count
+	auto key = [](const MeshOptimizerReport& report) {
+		return std::tie(report.vertices, report.triangles, report.clusters, report.before.acmr, report.before.atvr, report.after.acmr, report.after.atvr);
+	};
+	std::sort(reports.begin(), reports.end(), [&](const MeshOptimizerReport& a, const MeshOptimizerReport& b) {
+		return key(a) < key(b);
+	});
+
+	return reports;
+}
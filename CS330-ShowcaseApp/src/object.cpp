@@ -3,18 +3,8 @@
 #include <material.h>
 #include <model.h>
 #include <object.h>
-#include <shader.h>
 
-Object::Object(std::vector<Model> models) : _models{ models } {
-}
-
-void Object::Draw(Shader shader) {
-	for (auto model : _models) {
-		model.Draw(shader, Transform);
-	}
-}
-
-Object Object::CreatePlane()
+Entity Object::CreatePlane(Scene& scene)
 {
 	std::vector<Model> models {};
 	glm::vec4 color = { 0.3f, 0.3f, 0.3f, 1.f };
@@ -50,16 +40,16 @@ Object Object::CreatePlane()
 		0, 2, 3
 	};
 	Mesh mesh{ vertices, indices };
-	auto texture = std::make_shared<Texture>(Texture::texturePath / "plane.png");
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / "plane.png");
 	auto material = std::make_shared<Material>(texture);
 	material->shininess = 2.f;
 	Model plane{ material, { mesh } };
 	models.push_back(plane);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateStand() {
+Entity Object::CreateStand(Scene& scene) {
 	std::vector<Model> models {};
 
 	float width = 8.5f;
@@ -70,16 +60,16 @@ Object Object::CreateStand() {
 	leftMesh.Transform = glm::translate(leftMesh.Transform, { -width / 2 + 0.05f, 0.f, 0.f });
 	Mesh rightMesh = Mesh::CreateBox(0.1f, 0.9f, 3.f);
 	rightMesh.Transform = glm::translate(rightMesh.Transform, { width / 2 - 0.05f, 0.f, 0.f });
-	auto texture = std::make_shared<Texture>(Texture::texturePath / "cloudy.png");
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / "cloudy.png");
 	auto material = std::make_shared<Material>(texture);
 
 	Model model{ material, { topMesh, leftMesh, rightMesh } };
 	models.push_back(model);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateMonitor() {
+Entity Object::CreateMonitor(Scene& scene) {
 	std::vector<Model> models {};
 
 	glm::vec4 frameColor { 0.15f, 0.15f, 0.15f, 1.f };
@@ -93,7 +83,7 @@ Object Object::CreateMonitor() {
 	Mesh frameScreen = Mesh::CreateBox(6.7f, 4.f, 0.2f, frameColor);
 	frameScreen.Transform = glm::translate(frameScreen.Transform, { 0.f, 0.5f, 0.2f });
 
-	auto frameTexture = std::make_shared<Texture>(Texture::texturePath / "glossy.jpg");
+	auto frameTexture = TextureRegistry::Get().Load(Texture::texturePath / "glossy.jpg");
 	auto frameMaterial = std::make_shared<Material>(frameTexture);
 	frameMaterial->shininess = 400.f;
 
@@ -130,7 +120,7 @@ Object Object::CreateMonitor() {
 		0, 2, 3
 	};
 	Mesh screenMesh{ screenVertices, screenIndices };
-	auto minecraftTexture = std::make_shared<Texture>(Texture::texturePath / "minecraft.jpg");
+	auto minecraftTexture = TextureRegistry::Get().Load(Texture::texturePath / "minecraft.jpg");
 	auto screenMaterial = std::make_shared<Material>(minecraftTexture);
 	Model screen{ screenMaterial, { screenMesh } };
 	screen.Transform = glm::translate(screen.Transform, { 0.f, 0.6f, 0.301f });
@@ -139,10 +129,10 @@ Object Object::CreateMonitor() {
 	models.push_back(frame);
 	models.push_back(screen);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateClock() {
+Entity Object::CreateClock(Scene& scene) {
 	std::vector<Model> models {};
 	glm::vec4 color { 0.4f, 0.4f, 0.4f, 1.f };
 	float width = 0.75f;
@@ -157,7 +147,7 @@ Object Object::CreateClock() {
 	supportMesh.Transform = glm::translate(supportMesh.Transform, { 0.f, 0.f, -depth * 3 * glm::cos(tiltAngle) / 4 });
 	supportMesh.Transform = glm::rotate(supportMesh.Transform, -tiltAngle, glm::vec3(1, 0, 0));
 
-	auto texture = std::make_shared<Texture>(Texture::texturePath / "glossy.jpg");
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / "glossy.jpg");
 	auto material = std::make_shared<Material>(texture);
 	material->shininess = 16.f;
 
@@ -194,7 +184,7 @@ Object Object::CreateClock() {
 		0, 2, 3
 	};
 	Mesh screenMesh{ screenVertices, screenIndices };
-	auto screenTexture = std::make_shared<Texture>(Texture::texturePath / "clock.jpg");
+	auto screenTexture = TextureRegistry::Get().Load(Texture::texturePath / "clock.jpg");
 	auto screenMaterial = std::make_shared<Material>(screenTexture);
 	screenMaterial->shininess = 128.f;
 	Model base{ material, { clockMesh, supportMesh } };
@@ -206,32 +196,32 @@ Object Object::CreateClock() {
 	models.push_back(base);
 	models.push_back(screen);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateBook() {
+Entity Object::CreateBook(Scene& scene) {
 	std::vector<Model> models {};
 
 	Mesh mesh = Mesh::CreateBox(1.5f, 0.1f, 2.5f);
 
-	auto texture = std::make_shared<Texture>(Texture::texturePath / "book.png");
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / "book.png");
 	auto material = std::make_shared<Material>(texture);
 
 	Model model{ material, { mesh } };
 
 	models.push_back(model);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateBall() {
+Entity Object::CreateBall(Scene& scene) {
 	std::vector<Model> models {};
 	float radius = 0.35f;
 
-	Mesh mesh = Mesh::CreateSphere(radius, 16, 32, {1.f, 0.2f, 0.8f, 1.f});
+	Mesh mesh = Mesh::CreateSphere(radius, 32, 64, {1.f, 0.2f, 0.8f, 1.f});
 	mesh.Transform = glm::translate(mesh.Transform, { 0.f, radius, 0.f });
 	mesh.Transform = glm::rotate(mesh.Transform, 1.07f, glm::vec3{ 1, 1, 1});
-	auto texture = std::make_shared<Texture>(Texture::texturePath / "fuzz.jpg");
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / "fuzz.jpg");
 	auto material = std::make_shared<Material>(
 		texture,
 		glm::vec3 { 1.f, 1.f, 1.f },
@@ -243,10 +233,10 @@ Object Object::CreateBall() {
 
 	models.push_back(model);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
 
-Object Object::CreateJewel() {
+Entity Object::CreateJewel(Scene& scene) {
 
 	std::vector<Model> models {};
 
@@ -256,7 +246,7 @@ Object Object::CreateJewel() {
 	Mesh jewelUpperMesh = Mesh::CreateCylinder(0.2f, 0.3f, 0.5f, 12, color);
 	Mesh jewelTopMesh = Mesh::CreateCircle(0.3f, 12, color);
 	jewelTopMesh.Transform = glm::translate(jewelTopMesh.Transform, glm::vec3(0.f, 0.2f, 0.f));
-	auto glossyTexture = std::make_shared<Texture>(Texture::texturePath / "glossy-transparent.png");
+	auto glossyTexture = TextureRegistry::Get().Load(Texture::texturePath / "glossy-transparent.png");
 	auto glossyMaterial = std::make_shared<Material>(glossyTexture);
 	glossyMaterial->shininess = 128.f;
 
@@ -264,5 +254,5 @@ Object Object::CreateJewel() {
 	jewel.Transform = glm::translate(jewel.Transform, { 0.f, 0.5f, 0.f });
 	models.push_back(jewel);
 
-	return Object(models);
+	return scene.Spawn(models);
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <program_cache.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+#include <gl_capabilities.h>
+#include <mapped_file.h>
+
+// Bump when the file layout changes, old files are simply not found anymore
+static constexpr uint32_t cacheVersion = 1;
+static constexpr char cacheMagic[4] = { 'G', 'L', 'P', 'B' };
+
+struct CachedHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t size;
+};
+
+const std::filesystem::path ProgramCache::cachePath = { std::filesystem::current_path() / "cache" / "shaders" };
+
+uint64_t ProgramCache::hash(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	// FNV-1a, a driver update changes the strings and with them every key
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto mix = [&](std::string_view text) {
+		for (auto byte : text) {
+			hash ^= static_cast<uint8_t>(byte);
+			hash *= 0x100000001b3ull;
+		}
+		// Separator, so moving text from one part to the next changes the key
+		hash ^= 0xff;
+		hash *= 0x100000001b3ull;
+	};
+
+	mix(vertexSource);
+	mix(fragmentSource);
+	for (auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		auto value = reinterpret_cast<const char*>(glGetString(name));
+		mix(value ? value : "");
+	}
+	mix(std::string_view{ reinterpret_cast<const char*>(&cacheVersion), sizeof(cacheVersion) });
+
+	return hash;
+}
+
+std::filesystem::path ProgramCache::cachedFile(uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.glprog", static_cast<unsigned long long>(key));
+
+	return cachePath / name;
+}
+
+GLProgram ProgramCache::Load(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	if (!GLCapabilities::Get().programBinary) {
+		return {};
+	}
+
+	auto key = hash(vertexSource, fragmentSource);
+	MappedFile mapping{ cachedFile(key) };
+	if (!mapping.IsValid()) {
+		return {};
+	}
+
+	auto bytes = mapping.Data();
+	CachedHeader header{};
+	if (bytes.size() < sizeof(header)) {
+		return {};
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion || header.key != key
+		|| header.size > bytes.size() - sizeof(header)) {
+		return {};
+	}
+
+	// Drivers may refuse their own binaries after an update that kept the version string
+	auto program = GLProgram::Create();
+	glProgramBinary(program.Get(), header.binaryFormat, bytes.data() + sizeof(header), static_cast<GLsizei>(header.size));
+	GLint linked = 0;
+	glGetProgramiv(program.Get(), GL_LINK_STATUS, &linked);
+	if (!linked) {
+		return {};
+	}
+
+	return program;
+}
+
+void ProgramCache::Store(GLuint program, const std::string& vertexSource, const std::string& fragmentSource)
+{
+	if (!GLCapabilities::Get().programBinary) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	auto key = hash(vertexSource, fragmentSource);
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+	CachedHeader header{};
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.key = key;
+	header.binaryFormat = binaryFormat;
+	header.size = static_cast<uint32_t>(length);
+
+	// Written next to the target and renamed over it, a reader never maps half a file
+	std::error_code error{};
+	std::filesystem::create_directories(cachePath, error);
+	auto target = cachedFile(key);
+	auto temporary = target;
+	temporary += ".tmp";
+	std::ofstream file{ temporary, std::ios::binary };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), length);
+	file.close();
+	// A short write must not replace a good entry
+	if (!file) {
+		std::cerr << "Failed to write shader cache file: " << temporary << std::endl;
+		std::filesystem::remove(temporary, error);
+		return;
+	}
+	std::filesystem::rename(temporary, target, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+	}
+}
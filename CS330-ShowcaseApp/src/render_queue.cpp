@@ -0,0 +1,400 @@
+#include <render_queue.h>
+#include <gl_capabilities.h>
+#include <job_system.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <glm/gtc/matrix_inverse.hpp>
+
+// Packets per job for the parallel loops, small enough that the desk scene stays on one thread
+static constexpr size_t ParallelGrain = 2048;
+
+static uint64_t bits(uint64_t value, uint32_t count, uint32_t shift) {
+	return (value & ((1ull << count) - 1)) << shift;
+}
+
+// Positive floats compare like their bit patterns, so the top bits make a monotonic depth key
+static uint64_t depthBits(float depth, uint32_t count) {
+	uint32_t raw;
+	depth = std::max(depth, 0.f);
+	std::memcpy(&raw, &depth, sizeof(raw));
+
+	return raw >> (32 - count);
+}
+
+void RenderQueue::Begin(const glm::vec3& viewPosition, const glm::mat4& viewProjection)
+{
+	_viewPosition = viewPosition;
+	_frustum = Frustum{ viewProjection };
+	_packets.clear();
+	_order.clear();
+	_slotMaterials.clear();
+}
+
+void RenderQueue::Push(Shader& shader, Material& material, Mesh& mesh, const glm::mat4& transform, const glm::vec4& tint)
+{
+	Set(Allocate(1), shader, material, mesh, transform, tint);
+}
+
+size_t RenderQueue::Allocate(size_t count)
+{
+	auto first = _packets.size();
+	_packets.resize(first + count);
+	_order.resize(first + count);
+
+	return first;
+}
+
+void RenderQueue::Reserve(size_t count)
+{
+	_packets.reserve(count);
+	_order.reserve(count);
+	_worldBounds.Reserve(count);
+	_visible.reserve(count);
+	_instances.reserve(count);
+	_batches.reserve(count);
+	_commands.reserve(count);
+}
+
+void RenderQueue::Set(size_t index, Shader& shader, Material& material, Mesh& mesh, const glm::mat4& transform, const glm::vec4& tint)
+{
+	auto& packet = _packets[index];
+	packet = {
+		.shader = &shader,
+		.material = &material,
+		.texture = material.GetTexture().get(),
+		.mesh = &mesh,
+		.transform = transform,
+		.tint = tint,
+		.depth = glm::distance(_viewPosition, glm::vec3(transform[3]))
+	};
+	packet.key = makeKey(packet);
+
+	_order[index] = { packet.key, static_cast<uint32_t>(index) };
+}
+
+uint64_t RenderQueue::makeKey(const DrawPacket& packet) const
+{
+	uint64_t program = packet.shader->Program();
+	uint64_t texture = packet.texture->Handle();
+	uint64_t pool = packet.mesh->GeometryPool();
+	uint64_t mesh = packet.mesh->GeometryId();
+
+	if (packet.material->IsTranslucent()) {
+		return bits(1, 1, 63)
+			| bits(~depthBits(packet.depth, 16), 16, 47)
+			| bits(program, 6, 41)
+			| bits(texture, 10, 31)
+			| bits(pool, 3, 28)
+			| bits(mesh, 19, 9);
+	}
+
+	return bits(program, 6, 57)
+		| bits(texture, 10, 47)
+		| bits(pool, 3, 44)
+		| bits(mesh, 19, 25)
+		| bits(depthBits(packet.depth, 25), 25, 0);
+}
+
+void RenderQueue::cull()
+{
+	// World boxes are gathered in one pass so the frustum test can run over four at a time
+	_worldBounds.Resize(_order.size());
+	_visible.resize(_order.size());
+	JobSystem::Get().ParallelFor(_order.size(), ParallelGrain, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			auto& packet = _packets[_order[i].index];
+			_worldBounds.Set(i, packet.mesh->Bounds().Transformed(packet.transform));
+		}
+		_frustum.Cull(_worldBounds, begin, end, _visible.data());
+	});
+
+	size_t visible = 0;
+	for (size_t i = 0; i < _order.size(); i++) {
+		if (_visible[i]) {
+			_order[visible++] = _order[i];
+		}
+	}
+
+	_stats.culled = static_cast<uint32_t>(_order.size() - visible);
+	_order.resize(visible);
+}
+
+uint32_t RenderQueue::countStateChanges() const
+{
+	// Mirrors the rules Flush uses to skip redundant binds
+	const Shader* shader = nullptr;
+	std::optional<GLuint> texture{};
+	const Mesh* mesh = nullptr;
+	uint32_t changes = 0;
+
+	// _order holds the visible packets, in submission order until it is sorted
+	for (auto& entry : _order) {
+		auto& packet = _packets[entry.index];
+
+		if (packet.shader != shader) {
+			shader = packet.shader;
+			changes++;
+		}
+		if (packet.texture->Handle() != texture) {
+			texture = packet.texture->Handle();
+			changes++;
+		}
+		if (!mesh || packet.mesh->VertexArray() != mesh->VertexArray()) {
+			mesh = packet.mesh;
+			changes++;
+		}
+	}
+
+	return changes;
+}
+
+// Rigid and uniformly scaled transforms have orthogonal columns of equal length. Their normal matrix is the
+// transform itself up to a scale the fragment shader normalizes away, so only the rest pay for an inverse.
+bool RenderQueue::normalMatrix(const glm::mat4& transform, glm::mat3& normal)
+{
+	glm::mat3 linear{ transform };
+	float x = glm::dot(linear[0], linear[0]);
+	float y = glm::dot(linear[1], linear[1]);
+	float z = glm::dot(linear[2], linear[2]);
+	float tolerance = 1e-4f * std::max({ x, y, z });
+
+	bool uniform = std::abs(x - y) <= tolerance && std::abs(y - z) <= tolerance
+		&& std::abs(glm::dot(linear[0], linear[1])) <= tolerance
+		&& std::abs(glm::dot(linear[0], linear[2])) <= tolerance
+		&& std::abs(glm::dot(linear[1], linear[2])) <= tolerance;
+	if (uniform) {
+		normal = linear;
+		return false;
+	}
+
+	normal = glm::inverseTranspose(linear);
+	return true;
+}
+
+uint32_t RenderQueue::materialIndex(const Material& material)
+{
+	// At most MaxMaterials entries, a scan is cheap enough and a map would allocate every frame
+	auto found = std::find(_slotMaterials.begin(), _slotMaterials.end(), &material);
+	if (found != _slotMaterials.end()) {
+		return static_cast<uint32_t>(found - _slotMaterials.begin());
+	}
+
+	if (_stats.materials == MaxMaterials) {
+		static bool warned = false;
+		if (!warned) {
+			std::cerr << "More than " << MaxMaterials << " materials in one frame, the rest draw with the first" << std::endl;
+			warned = true;
+		}
+		return 0;
+	}
+
+	_slotMaterials.push_back(&material);
+	_materials.materials[_stats.materials] = material.GPU();
+	return _stats.materials++;
+}
+
+void RenderQueue::uploadInstances()
+{
+	// Material slots are assigned in order, so they are looked up first on this thread. Sorted packets
+	// of one material tend to be adjacent, which saves most of the lookups.
+	const Material* material = nullptr;
+	uint32_t materialSlot = 0;
+
+	_instances.resize(_order.size());
+	for (size_t i = 0; i < _order.size(); i++) {
+		auto& packet = _packets[_order[i].index];
+		if (packet.material != material) {
+			material = packet.material;
+			materialSlot = materialIndex(*material);
+		}
+		_instances[i].MaterialIndex = materialSlot;
+	}
+
+	std::atomic<uint32_t> inverses{};
+	JobSystem::Get().ParallelFor(_order.size(), ParallelGrain, [&](size_t begin, size_t end) {
+		uint32_t rangeInverses = 0;
+		for (size_t i = begin; i < end; i++) {
+			auto& packet = _packets[_order[i].index];
+			auto& instance = _instances[i];
+			instance.ModelRows = glm::mat3x4{ glm::transpose(packet.transform) };
+			rangeInverses += normalMatrix(packet.transform, instance.NormalMatrix);
+			instance.Tint = packet.tint;
+		}
+		inverses += rangeInverses;
+	});
+	_stats.normalMatrixInverses = inverses;
+
+	if (!_materialsBuffer.IsValid()) {
+		_materialsBuffer = UniformBuffer<MaterialsBlock>(UniformBlock::Materials);
+	}
+	_materialsBuffer.Update(_materials, _stats.materials * sizeof(MaterialGPU));
+
+	if (!_instanceBuffer) {
+		_instanceBuffer = GLBuffer::Create();
+	}
+
+	// Reallocating every frame orphans last frame's storage instead of waiting for the GPU to finish with it
+	auto size = _instances.size() * sizeof(InstanceData);
+	_instanceBufferCapacity = std::max(_instanceBufferCapacity, size);
+	glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer.Get());
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instanceBufferCapacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), _instances.data());
+}
+
+void RenderQueue::uploadCommands()
+{
+	_commands.clear();
+	for (auto& batch : _batches) {
+		auto& packet = _packets[_order[batch.first].index];
+		_commands.push_back(packet.mesh->IndirectCommand(batch.count, batch.first));
+	}
+
+	if (!_commandBuffer) {
+		_commandBuffer = GLBuffer::Create();
+	}
+
+	// Orphaned like the instance buffer, stays bound for the draws of this flush
+	auto size = _commands.size() * sizeof(DrawElementsIndirectCommand);
+	_commandBufferCapacity = std::max(_commandBufferCapacity, size);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer.Get());
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(_commandBufferCapacity), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, static_cast<GLsizeiptr>(size), _commands.data());
+}
+
+void RenderQueue::Release()
+{
+	_instanceBuffer.Reset();
+	_instanceBufferCapacity = 0;
+	_commandBuffer.Reset();
+	_commandBufferCapacity = 0;
+	_materialsBuffer.Release();
+}
+
+bool RenderQueue::UsesMultiDrawIndirect() const
+{
+	return _multiDrawIndirect && GLCapabilities::Get().multiDrawIndirect;
+}
+
+void RenderQueue::drawBatches(size_t first, size_t last, bool indirect)
+{
+	auto& packet = _packets[_order[_batches[first].first].index];
+
+	if (indirect) {
+		auto offset = (void*)(first * sizeof(DrawElementsIndirectCommand));
+		glMultiDrawElementsIndirect(packet.mesh->Mode(), packet.mesh->IndexType(), offset, static_cast<GLsizei>(last - first), 0);
+		_stats.drawCalls++;
+		return;
+	}
+
+	// Without baseInstance every batch moves the instance attributes to its first instance instead
+	bool hasBaseInstance = GLCapabilities::Get().baseInstance;
+
+	for (size_t i = first; i < last; i++) {
+		auto& batch = _batches[i];
+		auto& mesh = *_packets[_order[batch.first].index].mesh;
+
+		if (hasBaseInstance) {
+			mesh.DrawInstanced(static_cast<GLsizei>(batch.count), batch.first);
+		}
+		else {
+			GeometryArena::Get().SetInstanceBuffer(_instanceBuffer.Get(), static_cast<GLintptr>(batch.first * sizeof(InstanceData)));
+			mesh.DrawInstanced(static_cast<GLsizei>(batch.count));
+		}
+		_stats.drawCalls++;
+	}
+}
+
+void RenderQueue::Flush()
+{
+	_stats = {};
+	_stats.packets = static_cast<uint32_t>(_packets.size());
+	if (_frustumCulling) {
+		cull();
+	}
+	_stats.visible = static_cast<uint32_t>(_order.size());
+	if (_order.empty()) {
+		return;
+	}
+	_stats.unsortedStateChanges = countStateChanges();
+
+	std::sort(_order.begin(), _order.end(), [](const SortEntry& a, const SortEntry& b) {
+		return a.key != b.key ? a.key < b.key : a.index < b.index;
+	});
+
+	uploadInstances();
+
+	// Never more batches than packets, reserved to that they cannot grow mid frame
+	_batches.clear();
+	_batches.reserve(_packets.size());
+	_commands.reserve(_packets.size());
+	for (size_t first = 0; first < _order.size();) {
+		auto& packet = _packets[_order[first].index];
+
+		size_t last = first + 1;
+		while (last < _order.size()) {
+			auto& next = _packets[_order[last].index];
+			if (next.shader != packet.shader || next.texture->Handle() != packet.texture->Handle() || !next.mesh->SharesGeometry(*packet.mesh)) {
+				break;
+			}
+			last++;
+		}
+
+		_batches.push_back({ static_cast<uint32_t>(first), static_cast<uint32_t>(last - first) });
+		if (packet.mesh->Mode() == GL_TRIANGLES) {
+			_stats.triangles += packet.mesh->Range().indexCount / 3 * static_cast<uint32_t>(last - first);
+		}
+		first = last;
+	}
+	_stats.batches = static_cast<uint32_t>(_batches.size());
+
+	bool indirect = UsesMultiDrawIndirect();
+	if (indirect) {
+		uploadCommands();
+	}
+
+	Shader* shader = nullptr;
+	// Textures that failed to load have handle 0, which still needs binding once
+	std::optional<GLuint> texture{};
+	GLuint vertexArray = 0;
+
+	// Consecutive batches with the same program, texture array and geometry pool make up one pass
+	for (size_t first = 0; first < _batches.size();) {
+		auto& packet = _packets[_order[_batches[first].first].index];
+
+		size_t last = first + 1;
+		while (last < _batches.size()) {
+			auto& next = _packets[_order[_batches[last].first].index];
+			if (next.shader != packet.shader || next.texture->Handle() != packet.texture->Handle()
+				|| next.mesh->VertexArray() != packet.mesh->VertexArray() || next.mesh->Mode() != packet.mesh->Mode()) {
+				break;
+			}
+			last++;
+		}
+
+		if (packet.shader != shader) {
+			shader = packet.shader;
+			shader->Bind();
+			_stats.stateChanges++;
+		}
+		if (packet.texture->Handle() != texture) {
+			texture = packet.texture->Handle();
+			packet.texture->Bind();
+			_stats.stateChanges++;
+		}
+		if (packet.mesh->VertexArray() != vertexArray) {
+			vertexArray = packet.mesh->VertexArray();
+			packet.mesh->Bind();
+			if (GLCapabilities::Get().baseInstance) {
+				GeometryArena::Get().SetInstanceBuffer(_instanceBuffer.Get(), 0);
+			}
+			_stats.stateChanges++;
+		}
+
+		drawBatches(first, last, indirect);
+		first = last;
+	}
+}
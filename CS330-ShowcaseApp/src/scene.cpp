@@ -0,0 +1,404 @@
+#include <scene.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <geometry_cache.h>
+#include <job_system.h>
+
+// Renderables per job when updating boxes and building the draw list
+static constexpr size_t ParallelGrain = 2048;
+// How far past the boundary between two levels, in levels, the size has to move to switch
+static constexpr float LodHysteresis = 0.2f;
+
+Entity Scene::Create(const glm::mat4& transform, Entity parent)
+{
+	auto entity = _transforms.Add(transform, parent);
+	_subtreeEnds.push_back(entity + 1);
+	_renderables.push_back(Null);
+
+	// Subtrees stay contiguous as long as children are created right after their parents
+	for (auto ancestor = parent; ancestor != Null; ancestor = _transforms.Parent(ancestor)) {
+		_subtreeEnds[ancestor] = entity + 1;
+	}
+
+	return entity;
+}
+
+Entity Scene::Spawn(const std::vector<Model>& models, const glm::mat4& transform)
+{
+	auto root = Create(transform);
+	for (auto& model : models) {
+		auto modelEntity = Create(model.Transform, root);
+		auto material = AddMaterial(model.GetMaterial());
+		for (auto& mesh : model.Meshes()) {
+			auto meshEntity = Create(mesh.Transform, modelEntity);
+			AddRenderable(meshEntity, AddMesh(mesh), material);
+		}
+	}
+
+	return root;
+}
+
+Entity Scene::Clone(Entity root, Entity parent)
+{
+	auto prefab = Capture(root);
+	if (prefab.nodes.empty()) {
+		return Null;
+	}
+
+	return Instantiate(prefab, parent);
+}
+
+ScenePrefab Scene::Capture(Entity root) const
+{
+	auto end = _subtreeEnds[root];
+	for (auto entity = root + 1; entity < end; entity++) {
+		auto entityParent = _transforms.Parent(entity);
+		if (entityParent < root || entityParent >= end) {
+			std::cerr << "Entity " << root << " was not created in one go and cannot be cloned" << std::endl;
+			return {};
+		}
+	}
+
+	// Parents keep their offset from the root, which holds because every instance is contiguous too
+	ScenePrefab prefab{};
+	prefab.nodes.reserve(end - root);
+	for (auto entity = root; entity < end; entity++) {
+		auto& node = prefab.nodes.emplace_back();
+		node.local = _transforms.Local(entity);
+		node.parent = entity == root ? Null : _transforms.Parent(entity) - root;
+		node.mesh = Null;
+
+		auto renderable = _renderables[entity];
+		if (renderable != Null) {
+			node.mesh = _renderMeshes[renderable];
+			node.material = _renderMaterials[renderable];
+			node.tint = _renderTints[renderable];
+		}
+	}
+
+	return prefab;
+}
+
+Entity Scene::Instantiate(const ScenePrefab& prefab, Entity parent)
+{
+	auto copy = static_cast<Entity>(EntityCount());
+	for (auto& node : prefab.nodes) {
+		auto entity = Create(node.local, node.parent == Null ? parent : copy + node.parent);
+		if (node.mesh != Null) {
+			AddRenderable(entity, node.mesh, node.material, node.tint);
+		}
+	}
+
+	return prefab.nodes.empty() ? Null : copy;
+}
+
+void Scene::Destroy(Entity root)
+{
+	auto end = _subtreeEnds[root];
+	auto count = end - root;
+
+	// Renderables keep their order, the ones behind a removed one move down
+	std::vector<uint32_t> remap(_renderEntities.size(), Null);
+	uint32_t kept = 0;
+	for (uint32_t renderable = 0; renderable < _renderEntities.size(); renderable++) {
+		auto entity = _renderEntities[renderable];
+		if (entity >= root && entity < end) {
+			continue;
+		}
+
+		remap[renderable] = kept;
+		_renderEntities[kept] = entity >= end ? entity - count : entity;
+		_renderMeshes[kept] = _renderMeshes[renderable];
+		_renderMaterials[kept] = _renderMaterials[renderable];
+		_renderTints[kept] = _renderTints[renderable];
+		_renderLevels[kept] = _renderLevels[renderable];
+		_localBounds[kept] = _localBounds[renderable];
+		_worldBounds[kept] = _worldBounds[renderable];
+		kept++;
+	}
+	_renderEntities.resize(kept);
+	_renderMeshes.resize(kept);
+	_renderMaterials.resize(kept);
+	_renderTints.resize(kept);
+	_renderLevels.resize(kept);
+	_localBounds.resize(kept);
+	_worldBounds.resize(kept);
+	std::erase_if(_lodRenderables, [&](uint32_t renderable) { return remap[renderable] == Null; });
+	for (auto& renderable : _lodRenderables) {
+		renderable = remap[renderable];
+	}
+
+	_transforms.Erase(root, count);
+	_subtreeEnds.erase(_subtreeEnds.begin() + root, _subtreeEnds.begin() + end);
+	_renderables.erase(_renderables.begin() + root, _renderables.begin() + end);
+	for (auto& subtreeEnd : _subtreeEnds) {
+		if (subtreeEnd >= end) {
+			subtreeEnd -= count;
+		}
+	}
+	for (auto& renderable : _renderables) {
+		if (renderable != Null) {
+			renderable = remap[renderable];
+		}
+	}
+	for (auto& [type, pool] : _components) {
+		pool->Erase(root, count);
+	}
+
+	_changedNodes.clear();
+	_changedRenderables.clear();
+	_generation++;
+}
+
+void Scene::Clear()
+{
+	_transforms.Clear();
+	_subtreeEnds.clear();
+	_renderables.clear();
+	_renderEntities.clear();
+	_renderMeshes.clear();
+	_renderMaterials.clear();
+	_renderTints.clear();
+	_renderLevels.clear();
+	_localBounds.clear();
+	_worldBounds.clear();
+	_meshes.clear();
+	_meshLevels.clear();
+	_meshLodPixels.clear();
+	_lodRenderables.clear();
+	_materials.clear();
+	for (auto& [type, pool] : _components) {
+		pool->Clear();
+	}
+	_changedNodes.clear();
+	_changedRenderables.clear();
+	_generation++;
+}
+
+void Scene::SetTint(Entity entity, const glm::vec4& tint)
+{
+	for (auto descendant = entity; descendant < _subtreeEnds[entity]; descendant++) {
+		if (_renderables[descendant] != Null) {
+			_renderTints[_renderables[descendant]] = tint;
+		}
+	}
+}
+
+uint32_t Scene::AddMesh(Mesh mesh)
+{
+	if (auto lods = mesh.Lods()) {
+		std::vector<Mesh> levels{ std::move(mesh) };
+		levels.insert(levels.end(), lods->levels.begin() + 1, lods->levels.end());
+		return AddMeshLevels(levels, lods->fullDetailPixels);
+	}
+
+	_meshes.push_back(std::move(mesh));
+	_meshLevels.push_back(1);
+	_meshLodPixels.push_back(0.f);
+	return static_cast<uint32_t>(_meshes.size() - 1);
+}
+
+uint32_t Scene::AddMeshLevels(std::span<const Mesh> levels, float fullDetailPixels)
+{
+	auto index = static_cast<uint32_t>(_meshes.size());
+	_meshes.insert(_meshes.end(), levels.begin(), levels.end());
+	_meshLevels.resize(_meshes.size(), 1);
+	_meshLodPixels.resize(_meshes.size(), 0.f);
+	_meshLevels[index] = static_cast<uint8_t>(levels.size());
+	_meshLodPixels[index] = fullDetailPixels;
+
+	return index;
+}
+
+uint32_t Scene::AddMaterial(std::shared_ptr<Material> material)
+{
+	// Models of one object often share a material, the last one is the only likely repeat
+	if (!_materials.empty() && _materials.back() == material) {
+		return static_cast<uint32_t>(_materials.size() - 1);
+	}
+
+	_materials.push_back(std::move(material));
+	return static_cast<uint32_t>(_materials.size() - 1);
+}
+
+uint32_t Scene::AddRenderable(Entity entity, uint32_t mesh, uint32_t material, const glm::vec4& tint)
+{
+	auto renderable = static_cast<uint32_t>(_renderEntities.size());
+	_renderables[entity] = renderable;
+	_renderEntities.push_back(entity);
+	_renderMeshes.push_back(mesh);
+	_renderMaterials.push_back(material);
+	_renderTints.push_back(tint);
+	_renderLevels.push_back(0);
+	if (_meshLevels[mesh] > 1) {
+		_lodRenderables.push_back(renderable);
+	}
+	_localBounds.push_back(_meshes[mesh].Bounds());
+	_worldBounds.push_back(_meshes[mesh].Bounds());
+
+	return renderable;
+}
+
+void Scene::AddSystem(std::string name, System system, const std::vector<std::string>& after)
+{
+	auto find = [this](const std::string& name) {
+		return std::find_if(_systems.begin(), _systems.end(), [&](auto& entry) { return entry.name == name; });
+	};
+
+	auto found = find(name);
+	for (auto& dependency : after) {
+		auto position = find(dependency);
+		if (position == _systems.end() || position >= found) {
+			std::cerr << "System " << name << " runs after " << dependency << ", which has to be added before it" << std::endl;
+		}
+	}
+
+	if (found != _systems.end()) {
+		found->system = std::move(system);
+		found->after = after;
+		return;
+	}
+
+	_systems.push_back({ .name = std::move(name), .system = std::move(system), .after = after });
+}
+
+void Scene::RemoveSystem(const std::string& name)
+{
+	std::erase_if(_systems, [&](auto& entry) { return entry.name == name; });
+}
+
+void Scene::RunSystems(float deltaTime)
+{
+	auto& jobs = JobSystem::Get();
+
+	// Dependencies were added earlier, so their jobs exist by the time a system is scheduled
+	// The job captures two pointers, small enough for std::function to store without allocating
+	_systemJobs.clear();
+	_deltaTime = deltaTime;
+	for (auto& entry : _systems) {
+		_systemDependencies.clear();
+		for (auto& dependency : entry.after) {
+			for (size_t i = 0; i < _systemJobs.size(); i++) {
+				if (_systems[i].name == dependency) {
+					_systemDependencies.push_back(_systemJobs[i]);
+				}
+			}
+		}
+
+		_systemJobs.push_back(jobs.Schedule([this, &entry] { entry.system(*this, _deltaTime); }, _systemDependencies));
+	}
+
+	for (auto& job : _systemJobs) {
+		jobs.Wait(job);
+	}
+}
+
+std::span<const uint32_t> Scene::UpdateTransforms()
+{
+	_changedNodes.clear();
+	_changedRenderables.clear();
+	_worldMatrixUpdates = _transforms.Update(&_changedNodes);
+
+	for (auto node : _changedNodes) {
+		if (_renderables[node] != Null) {
+			_changedRenderables.push_back(_renderables[node]);
+		}
+	}
+
+	JobSystem::Get().ParallelFor(_changedRenderables.size(), ParallelGrain, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			auto renderable = _changedRenderables[i];
+			_worldBounds[renderable] = _localBounds[renderable].Transformed(_transforms.World(_renderEntities[renderable]));
+		}
+	});
+
+	return _changedRenderables;
+}
+
+// Leaves the current level only once the target is LodHysteresis past its boundary, so a size
+// right at a threshold does not flip the level every frame
+static uint32_t lodLevel(uint32_t current, float target)
+{
+	if (target >= current + 1 + LodHysteresis) {
+		return static_cast<uint32_t>(target - LodHysteresis);
+	}
+	if (target < current - LodHysteresis) {
+		return static_cast<uint32_t>(std::max(target + LodHysteresis, 0.f));
+	}
+	return current;
+}
+
+void Scene::SelectLods(const glm::vec3& viewPosition, const glm::mat4& projection, float viewportHeight, float bias)
+{
+	// Perspective projections divide by the distance, orthographic ones by 1
+	bool perspective = projection[2][3] != 0.f;
+	float pixelsPerUnit = projection[1][1] * viewportHeight;
+
+	// Target level as a fraction, each level is right for half the height of the one before
+	_lodTargets.resize(_lodRenderables.size());
+	JobSystem::Get().ParallelFor(_lodRenderables.size(), ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			auto renderable = _lodRenderables[i];
+			auto& mesh = _meshes[_renderMeshes[renderable]];
+			auto sphere = mesh.Sphere().Transformed(_transforms.World(_renderEntities[renderable]));
+			float distance = perspective ? std::max(glm::distance(sphere.center, viewPosition), 1e-4f) : 1.f;
+			float pixels = sphere.radius * pixelsPerUnit / distance * bias;
+			float target = std::log2(_meshLodPixels[_renderMeshes[renderable]] / std::max(pixels, 1e-4f));
+			_lodTargets[i] = std::clamp(target, -1.f, static_cast<float>(GeometryCache::MaxLodLevels));
+		}
+	});
+
+	// The finest target of a group wins
+	_lodSwitches = 0;
+	for (size_t first = 0; first < _lodRenderables.size();) {
+		auto parent = _transforms.Parent(_renderEntities[_lodRenderables[first]]);
+		float target = _lodTargets[first];
+		uint32_t current = _renderLevels[_lodRenderables[first]];
+		size_t last = first + 1;
+		while (parent != Null && last < _lodRenderables.size() && _transforms.Parent(_renderEntities[_lodRenderables[last]]) == parent) {
+			target = std::min(target, _lodTargets[last]);
+			current = std::max<uint32_t>(current, _renderLevels[_lodRenderables[last]]);
+			last++;
+		}
+
+		auto level = lodLevel(current, target);
+		for (size_t i = first; i < last; i++) {
+			auto renderable = _lodRenderables[i];
+			auto clamped = static_cast<uint8_t>(std::min<uint32_t>(level, _meshLevels[_renderMeshes[renderable]] - 1));
+			if (clamped != _renderLevels[renderable]) {
+				_renderLevels[renderable] = clamped;
+				_lodSwitches++;
+			}
+		}
+		first = last;
+	}
+}
+
+void Scene::Submit(RenderQueue& queue, Shader& shader)
+{
+	auto first = queue.Allocate(_renderEntities.size());
+	JobSystem::Get().ParallelFor(_renderEntities.size(), ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			submit(queue, shader, first + i, static_cast<uint32_t>(i));
+		}
+	});
+}
+
+void Scene::Submit(RenderQueue& queue, Shader& shader, std::span<const uint32_t> renderables)
+{
+	// The visible set changes size as the camera moves, the queue is sized for all of it once
+	queue.Reserve(_renderEntities.size());
+	auto first = queue.Allocate(renderables.size());
+	JobSystem::Get().ParallelFor(renderables.size(), ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			submit(queue, shader, first + i, renderables[i]);
+		}
+	});
+}
+
+void Scene::submit(RenderQueue& queue, Shader& shader, size_t packet, uint32_t renderable)
+{
+	queue.Set(packet, shader, *_materials[_renderMaterials[renderable]], _meshes[_renderMeshes[renderable] + _renderLevels[renderable]],
+		_transforms.World(_renderEntities[renderable]), _renderTints[renderable]);
+}
@@ -0,0 +1,415 @@
+#include <scene_description.h>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <material.h>
+#include <object.h>
+#include <texture.h>
+
+using ObjectFactory = Entity (*)(Scene& scene);
+
+static ObjectFactory deskObject(std::string_view kind)
+{
+	static const std::map<std::string_view, ObjectFactory> factories{
+		{ "plane", Object::CreatePlane },
+		{ "stand", Object::CreateStand },
+		{ "monitor", Object::CreateMonitor },
+		{ "clock", Object::CreateClock },
+		{ "book", Object::CreateBook },
+		{ "ball", Object::CreateBall },
+		{ "jewel", Object::CreateJewel }
+	};
+
+	auto found = factories.find(kind);
+	return found != factories.end() ? found->second : nullptr;
+}
+
+static bool isPrimitive(std::string_view kind)
+{
+	return kind == "box" || kind == "circle" || kind == "cylinder" || kind == "cone" || kind == "sphere";
+}
+
+// Comma separated numbers, returns how many were read or -1 when there are more than out holds
+static int parseFloats(std::string_view value, std::span<float> out)
+{
+	for (size_t count = 0; count < out.size(); count++) {
+		auto comma = value.find(',');
+		auto part = value.substr(0, comma);
+		auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), out[count]);
+		if (error != std::errc{} || end != part.data() + part.size()) {
+			return -1;
+		}
+		if (comma == std::string_view::npos) {
+			return static_cast<int>(count + 1);
+		}
+		value.remove_prefix(comma + 1);
+	}
+
+	return -1;
+}
+
+bool SceneDescription::Parse(std::string_view text, SceneDescription& description, std::string& error)
+{
+	SceneDescription parsed{};
+	size_t lineNumber = 0;
+	auto fail = [&](const std::string& message) {
+		error = "line " + std::to_string(lineNumber) + ": " + message;
+		return false;
+	};
+
+	std::vector<std::string_view> tokens{};
+	while (!text.empty()) {
+		auto newline = text.find('\n');
+		auto line = text.substr(0, newline);
+		text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		tokens.clear();
+		for (size_t start = line.find_first_not_of(" \t\r"); start != std::string_view::npos; start = line.find_first_not_of(" \t\r", start)) {
+			auto end = std::min(line.find_first_of(" \t\r", start), line.size());
+			tokens.push_back(line.substr(start, end - start));
+			start = end;
+		}
+		if (tokens.empty()) {
+			continue;
+		}
+
+		auto kind = tokens[0];
+		bool light = kind == "directional_light" || kind == "point_light";
+		bool desk = deskObject(kind) != nullptr;
+		if (!light && !desk && !isPrimitive(kind)) {
+			return fail("unknown kind " + std::string{ kind });
+		}
+
+		SceneObjectDescription object{ .kind = std::string{ kind } };
+		glm::vec3 lightVector{ 0.f, -1.f, 0.f };
+		glm::vec3 color{ 1.f };
+		glm::vec4 primitiveColor{ 1.f };
+		float ambient = 0.2f;
+		float diffuse = 0.8f;
+		float specular = 0.5f;
+		glm::vec3 size{ 1.f };
+		float radius = 0.5f;
+		float height = 1.f;
+		float top = 0.5f;
+		float bottom = 0.5f;
+		float stacks = 16.f;
+		float sectors = 32.f;
+
+		for (size_t i = 1; i < tokens.size(); i++) {
+			auto equals = tokens[i].find('=');
+			if (equals == std::string_view::npos) {
+				return fail("expected key=value, got " + std::string{ tokens[i] });
+			}
+			auto key = tokens[i].substr(0, equals);
+			auto value = tokens[i].substr(equals + 1);
+
+			// Reads exactly count numbers, or any count between minimum and count
+			auto numbers = [&](float* out, size_t count, size_t minimum = 0) {
+				auto read = parseFloats(value, { out, count });
+				return read >= static_cast<int>(minimum == 0 ? count : minimum);
+			};
+			auto bad = [&]() { return fail("bad value for " + std::string{ key } + ": " + std::string{ value }); };
+			auto unused = [&]() { return fail(std::string{ kind } + " has no " + std::string{ key }); };
+
+			if (light) {
+				bool ok = true;
+				if (key == (kind == "point_light" ? "position" : "direction")) {
+					ok = numbers(&lightVector.x, 3);
+				}
+				else if (key == "color") {
+					ok = numbers(&color.x, 3);
+				}
+				else if (key == "ambient") {
+					ok = numbers(&ambient, 1);
+				}
+				else if (key == "diffuse") {
+					ok = numbers(&diffuse, 1);
+				}
+				else if (key == "specular") {
+					ok = numbers(&specular, 1);
+				}
+				else {
+					return unused();
+				}
+				if (!ok) {
+					return bad();
+				}
+				continue;
+			}
+
+			bool ok = true;
+			bool primitiveKey = false;
+			bool materialKey = false;
+			if (key == "name") {
+				object.name = value;
+				ok = !value.empty();
+			}
+			else if (key == "position") {
+				glm::vec3 position{};
+				ok = numbers(&position.x, 3);
+				object.transform = glm::translate(object.transform, position);
+			}
+			else if (key == "rotate") {
+				glm::vec4 rotation{};
+				ok = numbers(&rotation.x, 4) && glm::vec3{ rotation.y, rotation.z, rotation.w } != glm::vec3{ 0.f };
+				if (ok) {
+					object.transform = glm::rotate(object.transform, glm::radians(rotation.x), glm::vec3{ rotation.y, rotation.z, rotation.w });
+				}
+			}
+			else if (key == "scale") {
+				glm::vec3 scale{ 1.f };
+				auto read = parseFloats(value, { &scale.x, 3 });
+				ok = read == 1 || read == 3;
+				object.transform = glm::scale(object.transform, read == 1 ? glm::vec3{ scale.x } : scale);
+			}
+			else if (key == "tint") {
+				ok = numbers(&object.tint.x, 4, 3);
+			}
+			else if (key == "color") {
+				primitiveKey = true;
+				ok = numbers(&primitiveColor.x, 4, 3);
+			}
+			else if (key == "size" && kind == "box") {
+				primitiveKey = true;
+				ok = numbers(&size.x, 3);
+			}
+			else if (key == "radius" && (kind == "circle" || kind == "cone" || kind == "sphere")) {
+				primitiveKey = true;
+				ok = numbers(&radius, 1) && radius > 0.f;
+			}
+			else if (key == "height" && (kind == "cylinder" || kind == "cone")) {
+				primitiveKey = true;
+				ok = numbers(&height, 1);
+			}
+			else if ((key == "top" || key == "bottom") && kind == "cylinder") {
+				primitiveKey = true;
+				ok = numbers(key == "top" ? &top : &bottom, 1);
+			}
+			else if (key == "sectors" && kind != "box") {
+				primitiveKey = true;
+				ok = numbers(&sectors, 1) && sectors >= 3.f;
+			}
+			else if (key == "stacks" && kind == "sphere") {
+				primitiveKey = true;
+				ok = numbers(&stacks, 1) && stacks >= 2.f;
+			}
+			else if (key == "texture") {
+				materialKey = true;
+				object.material.texture = value;
+			}
+			else if (key == "ambient" || key == "diffuse" || key == "specular") {
+				materialKey = true;
+				auto& target = key == "ambient" ? object.material.ambient : key == "diffuse" ? object.material.diffuse : object.material.specular;
+				ok = numbers(&target.x, 3);
+			}
+			else if (key == "shininess") {
+				materialKey = true;
+				ok = numbers(&object.material.shininess, 1);
+			}
+			else {
+				return unused();
+			}
+
+			// Desk objects bring their own meshes and materials
+			if (desk && (primitiveKey || materialKey)) {
+				return unused();
+			}
+			if (!ok) {
+				return bad();
+			}
+		}
+
+		if (kind == "directional_light") {
+			parsed.dirLight = {
+				.direction = lightVector,
+				.ambient = color * ambient,
+				.diffuse = color * diffuse,
+				.specular = color * specular
+			};
+			continue;
+		}
+		if (kind == "point_light") {
+			parsed.pointLights.push_back({
+				.position = lightVector,
+				.ambient = color * ambient,
+				.diffuse = color * diffuse,
+				.specular = color * specular
+			});
+			continue;
+		}
+
+		auto segments = static_cast<uint32_t>(sectors);
+		if (kind == "box") {
+			object.primitive = PrimitiveParams::Box(size.x, size.y, size.z, primitiveColor);
+		}
+		else if (kind == "circle") {
+			object.primitive = PrimitiveParams::Circle(radius, segments, primitiveColor);
+		}
+		else if (kind == "cylinder") {
+			object.primitive = PrimitiveParams::Cylinder(height, top, bottom, segments, primitiveColor);
+		}
+		else if (kind == "cone") {
+			object.primitive = PrimitiveParams::Cylinder(height, 0.f, radius, segments, primitiveColor);
+		}
+		else if (kind == "sphere") {
+			object.primitive = PrimitiveParams::Sphere(radius, static_cast<uint32_t>(stacks), segments, primitiveColor);
+		}
+		parsed.objects.push_back(std::move(object));
+	}
+
+	// Unnamed objects are numbered per kind, so adding one of another kind does not rename them
+	std::unordered_map<std::string, uint32_t> kindCounts{};
+	std::unordered_map<std::string, size_t> names{};
+	for (auto& object : parsed.objects) {
+		if (object.name.empty()) {
+			object.name = object.kind + "#" + std::to_string(kindCounts[object.kind]++);
+		}
+		if (!names.emplace(object.name, 0).second) {
+			error = "object name " + object.name + " is used twice";
+			return false;
+		}
+	}
+
+	description = std::move(parsed);
+	return true;
+}
+
+bool SceneDescription::Load(const std::filesystem::path& path, SceneDescription& description)
+{
+	std::ifstream file{ path };
+	if (!file) {
+		std::cerr << "Failed to open scene description: " << path << std::endl;
+		return false;
+	}
+	std::stringstream text{};
+	text << file.rdbuf();
+
+	std::string error{};
+	if (!Parse(text.str(), description, error)) {
+		std::cerr << "Failed to parse scene description " << path << ", " << error << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+SceneReloadStats SceneBuilder::Apply(const SceneDescription& description, Scene& scene)
+{
+	SceneReloadStats stats{};
+	std::unordered_map<std::string_view, const SceneObjectDescription*> wanted{};
+	for (auto& object : description.objects) {
+		wanted.emplace(object.name, &object);
+	}
+
+	// Removed and redefined objects go first. Every entity behind a destroyed one moves down.
+	for (auto live = _objects.begin(); live != _objects.end();) {
+		auto found = wanted.find(live->first);
+		bool keep = found != wanted.end() && found->second->SameDefinition(live->second.description);
+		if (keep) {
+			++live;
+			continue;
+		}
+
+		auto root = live->second.root;
+		auto entityCount = scene.EntityCount();
+		scene.Destroy(root);
+		auto destroyed = static_cast<Entity>(entityCount - scene.EntityCount());
+		for (auto& [name, other] : _objects) {
+			if (other.root > root) {
+				other.root -= destroyed;
+			}
+		}
+
+		if (found != wanted.end()) {
+			stats.rebuilt++;
+		}
+		else {
+			stats.removed++;
+		}
+		live = _objects.erase(live);
+	}
+
+	for (auto& object : description.objects) {
+		auto live = _objects.find(object.name);
+		if (live == _objects.end()) {
+			_objects.emplace(object.name, LiveObject{ object, create(object, scene) });
+			continue;
+		}
+
+		auto& current = live->second;
+		if (current.description.transform == object.transform && current.description.tint == object.tint) {
+			stats.unchanged++;
+			continue;
+		}
+		if (current.description.transform != object.transform) {
+			scene.SetTransform(current.root, object.transform);
+		}
+		if (current.description.tint != object.tint) {
+			scene.SetTint(current.root, object.tint);
+		}
+		current.description = object;
+		stats.updated++;
+	}
+
+	stats.added = static_cast<uint32_t>(description.objects.size()) - stats.unchanged - stats.updated - stats.rebuilt;
+	return stats;
+}
+
+void SceneBuilder::Reset()
+{
+	_objects.clear();
+	_prefabs.clear();
+	_meshes.clear();
+	_materials.clear();
+}
+
+Entity SceneBuilder::create(const SceneObjectDescription& object, Scene& scene)
+{
+	if (auto factory = deskObject(object.kind)) {
+		// Factories upload new geometry on every call, which a destroyed object would leave behind
+		Entity root = Scene::Null;
+		auto prefab = _prefabs.find(object.kind);
+		if (prefab != _prefabs.end()) {
+			root = scene.Instantiate(prefab->second);
+		}
+		else {
+			root = factory(scene);
+			_prefabs.emplace(object.kind, scene.Capture(root));
+		}
+		scene.SetTransform(root, object.transform);
+		if (object.tint != glm::vec4{ 1.f }) {
+			scene.SetTint(root, object.tint);
+		}
+		return root;
+	}
+
+	auto [found, inserted] = _meshes.try_emplace(object.primitive, 0);
+	if (inserted) {
+		found->second = scene.AddMesh(GeometryCache::Get().LoadLods(object.primitive));
+	}
+
+	auto root = scene.Create(object.transform);
+	scene.AddRenderable(root, found->second, material(object.material, scene), object.tint);
+	return root;
+}
+
+uint32_t SceneBuilder::material(const SceneMaterialDescription& description, Scene& scene)
+{
+	for (auto& [existing, index] : _materials) {
+		if (existing == description) {
+			return index;
+		}
+	}
+
+	auto texture = TextureRegistry::Get().Load(Texture::texturePath / description.texture);
+	auto material = std::make_shared<Material>(texture, description.ambient, description.diffuse, description.specular);
+	material->shininess = description.shininess;
+	auto index = scene.AddMaterial(std::move(material));
+	_materials.emplace_back(description, index);
+	return index;
+}
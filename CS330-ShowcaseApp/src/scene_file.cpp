@@ -0,0 +1,273 @@
+#include <scene_file.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <geometry_arena.h>
+#include <mapped_file.h>
+#include <material.h>
+#include <texture.h>
+
+static uint64_t align16(uint64_t offset)
+{
+	return (offset + 15) & ~uint64_t{ 15 };
+}
+
+bool SceneFile::Save(const Scene& scene, const std::filesystem::path& path)
+{
+	std::vector<SceneFileEntity> entities(scene.EntityCount());
+	for (uint32_t entity = 0; entity < entities.size(); entity++) {
+		entities[entity] = { .local = scene._transforms.Local(entity), .parent = scene._transforms.Parent(entity) };
+	}
+
+	// Materials often share a texture, each is written once. Paths are kept relative to the
+	// working directory when they are below it, like the assets folder.
+	std::vector<SceneFileTexture> textures{};
+	std::vector<SceneFileMaterial> materials{};
+	std::string strings{};
+	std::map<const Texture*, uint32_t> textureIndices{};
+	for (auto& material : scene._materials) {
+		auto& texture = material->GetTexture();
+		auto [found, inserted] = textureIndices.try_emplace(texture.get(), static_cast<uint32_t>(textures.size()));
+		if (inserted) {
+			std::error_code error{};
+			auto relative = std::filesystem::relative(texture->Path(), std::filesystem::current_path(), error);
+			auto texturePath = (error || relative.empty() ? texture->Path() : relative).generic_string();
+			auto& params = texture->Params();
+			textures.push_back({
+				.pathOffset = static_cast<uint32_t>(strings.size()),
+				.pathLength = static_cast<uint32_t>(texturePath.size()),
+				.flipVertically = params.flipVertically,
+				.generateMipmaps = params.generateMipmaps,
+				.compress = params.compress
+			});
+			strings += texturePath;
+		}
+
+		materials.push_back({
+			.ambient = material->Ambient(),
+			.shininess = material->shininess,
+			.diffuse = material->Diffuse(),
+			.texture = found->second,
+			.specular = material->Specular()
+		});
+	}
+
+	// Offsets are relative to the geometry section until it is placed
+	std::vector<SceneFileMesh> meshes(scene._meshes.size());
+	std::vector<std::byte> geometry{};
+	std::vector<std::byte> vertices{};
+	std::vector<std::byte> indices{};
+	for (size_t i = 0; i < meshes.size(); i++) {
+		auto& mesh = scene._meshes[i];
+		auto& range = mesh.Range();
+		GeometryArena::Get().Read(range, vertices, indices);
+
+		auto& record = meshes[i];
+		record = {
+			.vertexCount = range.vertexCount,
+			.indexCount = range.indexCount,
+			.mode = mesh.Mode(),
+			.indexType = range.indexType,
+			.format = range.format,
+			.levels = scene._meshLevels[i],
+			.fullDetailPixels = scene._meshLodPixels[i],
+			.bounds = mesh.Bounds(),
+			.sphere = mesh.Sphere()
+		};
+
+		record.vertexOffset = geometry.size();
+		geometry.insert(geometry.end(), vertices.begin(), vertices.end());
+		geometry.resize(align16(geometry.size()));
+		record.indexOffset = geometry.size();
+		geometry.insert(geometry.end(), indices.begin(), indices.end());
+		geometry.resize(align16(geometry.size()));
+	}
+
+	std::vector<SceneFileRenderable> renderables(scene.RenderableCount());
+	for (uint32_t renderable = 0; renderable < renderables.size(); renderable++) {
+		renderables[renderable] = {
+			.entity = scene._renderEntities[renderable],
+			.mesh = scene._renderMeshes[renderable],
+			.material = scene._renderMaterials[renderable],
+			.tint = scene._renderTints[renderable]
+		};
+	}
+
+	SceneFileHeader header{ .magic = Magic, .version = Version };
+	uint64_t end = sizeof(SceneFileHeader);
+	auto place = [&](SceneFileSection& section, size_t count, size_t size) {
+		section = { .offset = align16(end), .count = count };
+		end = section.offset + count * size;
+	};
+	place(header.entities, entities.size(), sizeof(SceneFileEntity));
+	place(header.meshes, meshes.size(), sizeof(SceneFileMesh));
+	place(header.textures, textures.size(), sizeof(SceneFileTexture));
+	place(header.materials, materials.size(), sizeof(SceneFileMaterial));
+	place(header.renderables, renderables.size(), sizeof(SceneFileRenderable));
+	place(header.strings, strings.size(), 1);
+	place(header.geometry, geometry.size(), 1);
+	for (auto& mesh : meshes) {
+		mesh.vertexOffset += header.geometry.offset;
+		mesh.indexOffset += header.geometry.offset;
+	}
+
+	// Written next to the target and renamed over it, a reader never maps half a file
+	auto temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file{ temporary, std::ios::binary };
+		uint64_t written = 0;
+		auto write = [&](const SceneFileSection& section, const void* data, size_t size) {
+			static constexpr char padding[16]{};
+			file.write(padding, static_cast<std::streamsize>(section.offset - written));
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			written = section.offset + size;
+		};
+
+		write({}, &header, sizeof(header));
+		write(header.entities, entities.data(), entities.size() * sizeof(SceneFileEntity));
+		write(header.meshes, meshes.data(), meshes.size() * sizeof(SceneFileMesh));
+		write(header.textures, textures.data(), textures.size() * sizeof(SceneFileTexture));
+		write(header.materials, materials.data(), materials.size() * sizeof(SceneFileMaterial));
+		write(header.renderables, renderables.data(), renderables.size() * sizeof(SceneFileRenderable));
+		write(header.strings, strings.data(), strings.size());
+		write(header.geometry, geometry.data(), geometry.size());
+
+		if (!file) {
+			std::cerr << "Failed to write scene file: " << temporary << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::cerr << "Failed to write scene file: " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool SceneFile::Load(const std::filesystem::path& path, Scene& scene)
+{
+	MappedFile file{ path };
+	if (!file.IsValid()) {
+		return false;
+	}
+
+	auto data = file.Data();
+	auto damaged = [&]() {
+		std::cerr << "Scene file is damaged: " << path << std::endl;
+		return false;
+	};
+
+	if (data.size() < sizeof(SceneFileHeader)) {
+		return damaged();
+	}
+	auto& header = *reinterpret_cast<const SceneFileHeader*>(data.data());
+	if (header.magic != Magic) {
+		return damaged();
+	}
+	if (header.version != Version) {
+		std::cerr << "Scene file " << path << " is version " << header.version << ", expected " << Version << std::endl;
+		return false;
+	}
+
+	// Records are used in place, a section only has to fit in the file and be aligned
+	bool valid = true;
+	auto section = [&]<typename T>(const SceneFileSection& section, const T*) -> std::span<const T> {
+		if (section.offset % alignof(T) != 0 || section.offset > data.size() || section.count > (data.size() - section.offset) / sizeof(T)) {
+			valid = false;
+			return {};
+		}
+		return { reinterpret_cast<const T*>(data.data() + section.offset), static_cast<size_t>(section.count) };
+	};
+	auto entities = section(header.entities, static_cast<const SceneFileEntity*>(nullptr));
+	auto meshes = section(header.meshes, static_cast<const SceneFileMesh*>(nullptr));
+	auto textures = section(header.textures, static_cast<const SceneFileTexture*>(nullptr));
+	auto materials = section(header.materials, static_cast<const SceneFileMaterial*>(nullptr));
+	auto renderables = section(header.renderables, static_cast<const SceneFileRenderable*>(nullptr));
+	auto strings = section(header.strings, static_cast<const char*>(nullptr));
+	if (!valid) {
+		return damaged();
+	}
+
+	// Check every reference before touching the scene, so a bad file adds nothing
+	for (size_t i = 0; i < entities.size(); i++) {
+		valid &= entities[i].parent == Scene::Null || entities[i].parent < i;
+	}
+	for (size_t i = 0; i < meshes.size(); i++) {
+		auto& mesh = meshes[i];
+		auto vertexBytes = uint64_t{ mesh.vertexCount } * GeometryArena::VertexSize(mesh.format);
+		auto indexBytes = uint64_t{ mesh.indexCount } * GeometryArena::IndexSize(mesh.indexType);
+		valid &= mesh.format <= VertexFormat::PackedHalf
+			&& (mesh.indexType == GL_UNSIGNED_SHORT || mesh.indexType == GL_UNSIGNED_INT)
+			&& mesh.vertexOffset <= data.size() && vertexBytes <= data.size() - mesh.vertexOffset
+			&& mesh.indexOffset <= data.size() && indexBytes <= data.size() - mesh.indexOffset
+			&& mesh.levels >= 1 && i + mesh.levels <= meshes.size();
+	}
+	for (auto& texture : textures) {
+		valid &= uint64_t{ texture.pathOffset } + texture.pathLength <= strings.size();
+	}
+	for (auto& material : materials) {
+		valid &= material.texture < textures.size();
+	}
+	for (auto& renderable : renderables) {
+		valid &= renderable.entity < entities.size() && renderable.mesh < meshes.size() && renderable.material < materials.size();
+	}
+	if (!valid) {
+		return damaged();
+	}
+
+	auto firstEntity = static_cast<Entity>(scene.EntityCount());
+	for (auto& entity : entities) {
+		scene.Create(entity.local, entity.parent == Scene::Null ? Scene::Null : firstEntity + entity.parent);
+	}
+
+	std::vector<std::shared_ptr<Texture>> loadedTextures{};
+	loadedTextures.reserve(textures.size());
+	for (auto& texture : textures) {
+		TextureParams params{
+			.flipVertically = texture.flipVertically != 0,
+			.generateMipmaps = texture.generateMipmaps != 0,
+			.compress = texture.compress != 0
+		};
+		loadedTextures.push_back(TextureRegistry::Get().Load(std::string_view{ strings.data() + texture.pathOffset, texture.pathLength }, params));
+	}
+
+	std::vector<uint32_t> materialIndices(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		auto& record = materials[i];
+		auto material = std::make_shared<Material>(loadedTextures[record.texture], record.ambient, record.diffuse, record.specular);
+		material->shininess = record.shininess;
+		materialIndices[i] = scene.AddMaterial(std::move(material));
+	}
+
+	// Uploaded straight from the mapped pages, the arena copies them into its buffers
+	std::vector<uint32_t> meshIndices(meshes.size());
+	std::vector<Mesh> levels{};
+	for (size_t i = 0; i < meshes.size();) {
+		auto& first = meshes[i];
+		levels.clear();
+		for (size_t level = 0; level < first.levels; level++) {
+			auto& record = meshes[i + level];
+			auto range = GeometryArena::Get().Upload(record.format, record.indexType, record.vertexCount, data.data() + record.vertexOffset,
+				record.indexCount, data.data() + record.indexOffset);
+			levels.emplace_back(record.mode, range, record.bounds, record.sphere);
+		}
+
+		auto index = levels.size() > 1 ? scene.AddMeshLevels(levels, first.fullDetailPixels) : scene.AddMesh(levels.front());
+		for (size_t level = 0; level < levels.size(); level++) {
+			meshIndices[i + level] = index + static_cast<uint32_t>(level);
+		}
+		i += levels.size();
+	}
+
+	for (auto& renderable : renderables) {
+		scene.AddRenderable(firstEntity + renderable.entity, meshIndices[renderable.mesh], materialIndices[renderable.material], renderable.tint);
+	}
+
+	return true;
+}
@@ -1,86 +1,254 @@
 #include <shader.h>
 #include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <glm/gtc/type_ptr.hpp>
+#include <gl_capabilities.h>
+#include <program_cache.h>
+
+// KHR_parallel_shader_compile, which GLAD was generated without
+static constexpr GLenum CompletionStatus = 0x91B1;
 
 Shader::Shader(const std::string &vertexSource, const std::string &fragmentSource) {
 	load(vertexSource, fragmentSource);
 }
 
-Shader::Shader(const Path& vertexPath, const Path& fragmentPath) {
-	// load sources from files
-	try {
-		std::ifstream vShaderFile, fShaderFile;
+Shader::Shader(const Path& vertexPath, const Path& fragmentPath) : _vertexPath{ vertexPath }, _fragmentPath{ fragmentPath } {
+	// Watched even when unreadable, so fixing the file brings the shader back
+	_vertexWatcher = FileWatcher{ vertexPath };
+	_fragmentWatcher = FileWatcher{ fragmentPath };
+
+	std::string vertexSource{}, fragmentSource{};
+	if (!readFile(vertexPath, vertexSource) || !readFile(fragmentPath, fragmentSource)) {
+		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+		return;
+	}
+
+	load(vertexSource, fragmentSource);
+}
 
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
+bool Shader::readFile(const Path& path, std::string& contents) {
+	std::ifstream file{ path };
+	if (!file) {
+		return false;
+	}
 
-		std::stringstream vShaderStream, fShaderStream;
+	std::stringstream stream{};
+	stream << file.rdbuf();
+	contents = stream.str();
+	return true;
+}
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+bool Shader::Update() {
+	// Editors often save both files at once, one rebuild covers them. A newer edit replaces a build in flight.
+	bool changed = _vertexWatcher.Changed();
+	changed = _fragmentWatcher.Changed() || changed;
+	std::string vertexSource{}, fragmentSource{};
+	if (changed && readFile(_vertexPath, vertexSource) && readFile(_fragmentPath, fragmentSource)) {
+		_pending = startBuild(std::move(vertexSource), std::move(fragmentSource));
+	}
 
-		// Loads Shader
-		load(vShaderStream.str(), fShaderStream.str());
+	if (!_pending.program || !isBuilt(_pending)) {
+		return false;
 	}
-	catch (std::ifstream::failure e) {
-		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+
+	auto build = std::move(_pending);
+	_pending = {};
+	if (!finishBuild(build)) {
+		std::cerr << "Keeping the previous program of " << _fragmentPath.filename() << std::endl;
+		return false;
 	}
+
+	ProgramCache::Store(build.program.Get(), build.vertexSource, build.fragmentSource);
+	use(std::move(build.program));
+	return true;
 }
 
 void Shader::Bind() {
 	// Call pyramid shader
-	glUseProgram(_shaderProgram);
+	glUseProgram(_shaderProgram.Get());
 }
 
 void Shader::load(const std::string &vertexSource, const std::string &fragmentSource) {
-	const char* vShaderCode = vertexSource.c_str();
-	const char* fShaderCode = fragmentSource.c_str();
+	if (auto program = ProgramCache::Load(vertexSource, fragmentSource)) {
+		use(std::move(program));
+		return;
+	}
 
-	auto vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
-	glCompileShader(vertexShader);
+	auto build = startBuild(vertexSource, fragmentSource);
+	if (finishBuild(build)) {
+		ProgramCache::Store(build.program.Get(), vertexSource, fragmentSource);
+		use(std::move(build.program));
+	}
+}
+
+void Shader::use(GLProgram program) {
+	_shaderProgram = std::move(program);
+	reflectUniforms();
+	bindUniformBlocks();
+}
+
+Shader::Build Shader::startBuild(std::string vertexSource, std::string fragmentSource) {
+	Build build{ .program = GLProgram::Create(), .vertexSource = std::move(vertexSource), .fragmentSource = std::move(fragmentSource) };
+
+	auto compile = [](GLenum stage, const std::string& source) {
+		const char* code = source.c_str();
+		auto shader = glCreateShader(stage);
+		glShaderSource(shader, 1, &code, nullptr);
+		glCompileShader(shader);
+		return shader;
+	};
+	build.vertexShader = compile(GL_VERTEX_SHADER, build.vertexSource);
+	build.fragmentShader = compile(GL_FRAGMENT_SHADER, build.fragmentSource);
+
+	auto program = build.program.Get();
+	glAttachShader(program, build.vertexShader);
+	glAttachShader(program, build.fragmentShader);
+	if (GLCapabilities::Get().programBinary) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+
+	// Only flagged while attached, they go away once finishBuild detaches them or the program is deleted
+	glDeleteShader(build.vertexShader);
+	glDeleteShader(build.fragmentShader);
+
+	return build;
+}
 
+bool Shader::isBuilt(const Build& build) {
+	if (!GLCapabilities::Get().parallelShaderCompile) {
+		return true;
+	}
+
+	GLint completed = 0;
+	glGetProgramiv(build.program.Get(), CompletionStatus, &completed);
+	return completed != 0;
+}
+
+bool Shader::finishBuild(Build& build) {
 	int success;
 	char infoLog[512];
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+	auto compiled = [&](GLuint shader, const char* stage) {
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+			std::cerr << "ERROR::SHADER::" << stage << "::FAILED\n" << infoLog << std::endl;
+		}
+		return success != 0;
+	};
+
+	// Both stages report their errors
+	bool vertexCompiled = compiled(build.vertexShader, "VERTEX");
+	bool fragmentCompiled = compiled(build.fragmentShader, "FRAGMENT");
+	auto program = build.program.Get();
+	glDetachShader(program, build.vertexShader);
+	glDetachShader(program, build.fragmentShader);
+	if (!vertexCompiled || !fragmentCompiled) {
+		return false;
+	}
 
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-		std::cerr << "ERROR::SHADER::VERTEX::FAILED\n" << infoLog << std::endl;
+		glGetProgramInfoLog(program, 512, nullptr, infoLog);
+		std::cerr << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << infoLog << std::endl;
+		return false;
 	}
 
-	auto fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fShaderCode, nullptr);
-	glCompileShader(fragmentShader);
+	return true;
+}
 
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-		std::cerr << "ERROR::SHADER::FRAGMENT::FAILED\n" << infoLog << std::endl;
+void Shader::bindUniformBlocks() {
+	for (GLuint binding = 0; binding < static_cast<GLuint>(UniformBlock::Count); binding++) {
+		auto blockIndex = glGetUniformBlockIndex(_shaderProgram.Get(), UniformBlockName(static_cast<UniformBlock>(binding)));
+
+		if (blockIndex != GL_INVALID_INDEX) {
+			glUniformBlockBinding(_shaderProgram.Get(), blockIndex, binding);
+		}
 	}
+}
 
-	// Link Shader to Fragments
-	_shaderProgram = glCreateProgram();
+void Shader::reflectUniforms() {
+	_reflectedLocations.clear();
+	_locations.clear();
 
-	glAttachShader(_shaderProgram, vertexShader);
-	glAttachShader(_shaderProgram, fragmentShader);
-	glLinkProgram(_shaderProgram);
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(_shaderProgram.Get(), GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(_shaderProgram.Get(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
 
-	glGetProgramiv(_shaderProgram, GL_LINK_STATUS, &success);
+	std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
 
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-		std::cerr << "ERROR::SHADER::FRAGMENT::LINK_FAILED\n" << infoLog << std::endl;
+	for (GLint i = 0; i < uniformCount; i++) {
+		GLint size = 0;
+		GLenum type = 0;
+		GLsizei nameLength = 0;
+		glGetActiveUniform(_shaderProgram.Get(), i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+
+		std::string name{ nameBuffer.data(), static_cast<size_t>(nameLength) };
+		GLint location = glGetUniformLocation(_shaderProgram.Get(), name.c_str());
+		if (location == -1) {
+			// Block members have no location
+			continue;
+		}
+
+		_reflectedLocations[name] = location;
+
+		// Arrays of basic types are reported once as "name[0]", register every element and the bare name
+		if (name.size() > 3 && name.ends_with("[0]")) {
+			auto baseName = name.substr(0, name.size() - 3);
+			_reflectedLocations[baseName] = location;
+
+			for (GLint element = 1; element < size; element++) {
+				auto elementName = baseName + "[" + std::to_string(element) + "]";
+				_reflectedLocations[elementName] = glGetUniformLocation(_shaderProgram.Get(), elementName.c_str());
+			}
+		}
+	}
+
+	// Intern every reflected name so that handles map straight onto the location table
+	uint32_t maxIndex = 0;
+	std::vector<std::pair<uint32_t, GLint>> reflectedIds{};
+	for (auto& [name, location] : _reflectedLocations) {
+		UniformId id{ name };
+		reflectedIds.emplace_back(id.Index(), location);
+		maxIndex = std::max(maxIndex, id.Index());
 	}
 
-	// Stores links and deletes temporary objects
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	_locations.assign(std::max(UniformId::Count(), maxIndex + 1), -1);
+	for (auto& [index, location] : reflectedIds) {
+		_locations[index] = location;
+	}
 }
 
 GLint Shader::getUniformLocation(const std::string &uniformName) {
+	auto it = _reflectedLocations.find(uniformName);
+
+	return it != _reflectedLocations.end() ? it->second : -1;
+}
+
+void Shader::setUniform(GLint location, const glm::mat4& value) {
+	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setUniform(GLint location, const glm::mat3& value) {
+	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setUniform(GLint location, const glm::vec4& value) {
+	glUniform4fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::setUniform(GLint location, const glm::vec3& value) {
+	glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::setUniform(GLint location, const float value) {
+	glUniform1f(location, value);
+}
 
-	return glGetUniformLocation(_shaderProgram, uniformName.c_str());
+void Shader::setUniform(GLint location, const int value) {
+	glUniform1i(location, value);
 }
 
 void Shader::SetMat4(const std::string& uniformName, const glm::mat4& mat4) {
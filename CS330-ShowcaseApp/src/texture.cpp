@@ -1,33 +1,115 @@
 #include <texture.h>
-#include <stb_image.h>
+#include <texture_cook.h>
+#include <texture_loader.h>
 #include <iostream>
 #include <filesystem>
 
-Texture::Texture(const std::filesystem::path& path)
+Texture::Texture(const std::filesystem::path& path, const TextureParams& params) : _path{ path }, _params{ params }
 {
-	stbi_set_flip_vertically_on_load(true);
-	auto texturePath = path.string();
+	std::vector<uint8_t> source{};
+	std::optional<TextureData> data{};
+	if (TextureCook::ReadFile(path, source)) {
+		data = TextureCook::Decode(source, params);
+	}
+	if (!data) {
+		std::cerr << "Failed to load texture at path: " << path << std::endl;
+		return;
+	}
+
+	auto& base = data->levels.front();
+	_array = TextureArray::Acquire({ GL_RGBA8, base.width, base.height, static_cast<int>(data->levels.size()) });
+	_layer = _array->AllocateLayer();
+	_isTranslucent = data->translucent;
+
+	for (size_t level = 0; level < data->levels.size(); level++) {
+		auto& pixels = data->levels[level].data;
+		_array->UploadLevel(_layer, static_cast<int>(level), pixels.data(), static_cast<GLsizei>(pixels.size()));
+	}
+}
+
+Texture::Texture(std::shared_ptr<Texture> placeholder) : _ready{ false }, _placeholder{ std::move(placeholder) }
+{}
 
-	int width, height, numChannels;
-	unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &numChannels, STBI_rgb_alpha);
+std::shared_ptr<Texture> Texture::CreatePending(std::shared_ptr<Texture> placeholder)
+{
+	return std::shared_ptr<Texture>(new Texture(std::move(placeholder)));
+}
 
-	glGenTextures(1, &_textureHandle);
-	glBindTexture(GL_TEXTURE_2D, _textureHandle);
+void Texture::markReady(bool isTranslucent, std::shared_ptr<TextureArray> array, uint32_t layer)
+{
+	_isTranslucent = isTranslucent;
+	_array = std::move(array);
+	_layer = layer;
+	_ready = true;
+	_placeholder.reset();
+}
 
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+Texture::~Texture()
+{
+	if (_array) {
+		_array->FreeLayer(_layer);
 	}
-	else {
-		std::cerr << "Failed to load texture at path: " << path << std::endl;
+}
+
+GLuint Texture::Handle() const
+{
+	if (!_ready) {
+		return _placeholder->Handle();
 	}
 
-	stbi_image_free(data);
+	return _array ? _array->Handle() : 0;
 }
 
 const std::filesystem::path Texture::texturePath = { std::filesystem::current_path() / "assets" / "textures" };
 
 void Texture::Bind()
 {
-	glBindTexture(GL_TEXTURE_2D, _textureHandle);
-}
\ No newline at end of file
+	glBindTexture(GL_TEXTURE_2D_ARRAY, Handle());
+}
+
+TextureRegistry& TextureRegistry::Get()
+{
+	static TextureRegistry registry{};
+	return registry;
+}
+
+std::shared_ptr<Texture> TextureRegistry::Load(const std::filesystem::path& path, const TextureParams& params)
+{
+	std::error_code error{};
+	auto canonicalPath = std::filesystem::weakly_canonical(path, error);
+	Key key{ (error ? path : canonicalPath).generic_string(), params };
+
+	if (auto texture = _textures[key].lock()) {
+		return texture;
+	}
+
+	// Forget textures that went away before adding a new one
+	std::erase_if(_textures, [](const auto& entry) { return entry.second.expired(); });
+
+	auto texture = TextureLoader::Get().Load(path, params);
+	_textures[key] = texture;
+
+	return texture;
+}
+
+uint64_t TextureRegistry::ResidentBytes() const
+{
+	uint64_t bytes = 0;
+	for (auto& [key, entry] : _textures) {
+		if (auto texture = entry.lock()) {
+			bytes += texture->SizeBytes();
+		}
+	}
+
+	return bytes;
+}
+
+size_t TextureRegistry::ResidentCount() const
+{
+	size_t count = 0;
+	for (auto& [key, entry] : _textures) {
+		count += entry.expired() ? 0 : 1;
+	}
+
+	return count;
+}
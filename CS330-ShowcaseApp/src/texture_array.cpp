@@ -0,0 +1,166 @@
+#include <texture_array.h>
+#include <algorithm>
+#include <map>
+
+static std::map<TextureArrayFormat, std::weak_ptr<TextureArray>>& arrays() {
+	static std::map<TextureArrayFormat, std::weak_ptr<TextureArray>> pool{};
+	return pool;
+}
+
+std::shared_ptr<TextureArray> TextureArray::Acquire(const TextureArrayFormat& format)
+{
+	auto& entry = arrays()[format];
+	if (auto array = entry.lock()) {
+		return array;
+	}
+
+	auto array = std::shared_ptr<TextureArray>(new TextureArray(format));
+	entry = array;
+
+	return array;
+}
+
+uint64_t TextureArray::AllocatedBytes()
+{
+	uint64_t bytes = 0;
+	for (auto& [format, entry] : arrays()) {
+		if (auto array = entry.lock()) {
+			bytes += array->LayerBytes() * array->_capacity;
+		}
+	}
+
+	return bytes;
+}
+
+TextureArray::TextureArray(const TextureArrayFormat& format) : _format{ format }
+{}
+
+TextureArray::~TextureArray() = default;
+
+size_t TextureArray::levelBytes(int level) const
+{
+	size_t width = std::max(_format.width >> level, 1);
+	size_t height = std::max(_format.height >> level, 1);
+
+	if (!isCompressed()) {
+		return width * height * 4;
+	}
+
+	// 4x4 blocks of 8 bytes for BC1, 16 for BC3
+	size_t blockBytes = _format.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8;
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+uint64_t TextureArray::LayerBytes() const
+{
+	uint64_t bytes = 0;
+	for (int level = 0; level < _format.levels; level++) {
+		bytes += levelBytes(level);
+	}
+
+	return bytes;
+}
+
+GLTexture TextureArray::createStorage(uint32_t layers)
+{
+	auto handle = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D_ARRAY, handle.Get());
+
+	for (int level = 0; level < _format.levels; level++) {
+		int width = std::max(_format.width >> level, 1);
+		int height = std::max(_format.height >> level, 1);
+
+		if (isCompressed()) {
+			auto size = static_cast<GLsizei>(levelBytes(level) * layers);
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, _format.format, width, height, layers, 0, size, nullptr);
+		}
+		else {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, _format.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, _format.levels > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR);
+
+	return handle;
+}
+
+void TextureArray::grow()
+{
+	uint32_t capacity = std::max(_capacity * 2, 1u);
+	auto handle = createStorage(capacity);
+
+	if (_capacity > 0) {
+		// Whole levels of the old array go through a pack buffer into the first layers of the new one
+		auto buffer = GLBuffer::Create();
+
+		for (int level = 0; level < _format.levels; level++) {
+			int width = std::max(_format.width >> level, 1);
+			int height = std::max(_format.height >> level, 1);
+			auto size = static_cast<GLsizei>(levelBytes(level) * _capacity);
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.Get());
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_COPY);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, _handle.Get());
+			if (isCompressed()) {
+				glGetCompressedTexImage(GL_TEXTURE_2D_ARRAY, level, nullptr);
+			}
+			else {
+				glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.Get());
+			glBindTexture(GL_TEXTURE_2D_ARRAY, handle.Get());
+			if (isCompressed()) {
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, _capacity, _format.format, size, nullptr);
+			}
+			else {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, _capacity, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+	}
+
+	_handle = std::move(handle);
+	_capacity = capacity;
+}
+
+uint32_t TextureArray::AllocateLayer()
+{
+	if (!_freeLayers.empty()) {
+		auto layer = _freeLayers.back();
+		_freeLayers.pop_back();
+		return layer;
+	}
+
+	if (_used == _capacity) {
+		grow();
+	}
+
+	return _used++;
+}
+
+void TextureArray::FreeLayer(uint32_t layer)
+{
+	_freeLayers.push_back(layer);
+}
+
+void TextureArray::UploadLevel(uint32_t layer, int level, const void* pixels, GLsizei imageSize)
+{
+	int width = std::max(_format.width >> level, 1);
+	int height = std::max(_format.height >> level, 1);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _handle.Get());
+	if (isCompressed()) {
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, _format.format, imageSize, pixels);
+	}
+	else {
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+}
+
+void TextureArray::Bind()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _handle.Get());
+}
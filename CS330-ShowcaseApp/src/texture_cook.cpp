@@ -0,0 +1,324 @@
+#include <texture_cook.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <stb_dxt.h>
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+// Bump when the cooked layout or the encoder settings change, old files are simply not found anymore
+static constexpr uint32_t cookVersion = 2;
+static constexpr char cookMagic[4] = { 'B', 'C', 'T', 'X' };
+
+struct CookedHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t levelCount;
+	uint32_t translucent;
+	uint32_t reserved;
+};
+
+struct CookedLevel {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+const std::filesystem::path TextureCook::cachePath = { std::filesystem::current_path() / "cache" / "textures" };
+
+uint64_t TextureData::SizeBytes() const
+{
+	uint64_t bytes = 0;
+	for (auto& level : levels) {
+		bytes += level.data.size();
+	}
+
+	return bytes;
+}
+
+bool TextureCook::ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& contents)
+{
+	std::ifstream file{ path, std::ios::binary | std::ios::ate };
+	if (!file) {
+		return false;
+	}
+
+	contents.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size())));
+}
+
+// Closest power of two, so textures of similar size end up in the same array
+static int arraySize(int size) {
+	int lower = 1;
+	while (lower * 2 <= size) {
+		lower *= 2;
+	}
+
+	return size - lower < lower * 2 - size ? lower : lower * 2;
+}
+
+std::optional<TextureData> TextureCook::Decode(std::span<const uint8_t> source, const TextureParams& params)
+{
+	// The flip flag is global in stb_image, the thread local override keeps workers independent
+	stbi_set_flip_vertically_on_load_thread(params.flipVertically);
+
+	int width, height, numChannels;
+	unsigned char* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &numChannels, STBI_rgb_alpha);
+	if (!pixels) {
+		return std::nullopt;
+	}
+
+	int sourceWidth = width;
+	int sourceHeight = height;
+	width = arraySize(width);
+	height = arraySize(height);
+
+	// Sized up front so the level spans stay valid
+	std::vector<std::pair<int, int>> sizes{ { width, height } };
+	size_t totalBytes = static_cast<size_t>(width) * height * 4;
+	while (params.generateMipmaps && (width > 1 || height > 1)) {
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		sizes.push_back({ width, height });
+		totalBytes += static_cast<size_t>(width) * height * 4;
+	}
+
+	TextureData data{};
+	data.storage.resize(totalBytes);
+	auto [baseWidth, baseHeight] = sizes.front();
+	if (sourceWidth == baseWidth && sourceHeight == baseHeight) {
+		std::memcpy(data.storage.data(), pixels, static_cast<size_t>(baseWidth) * baseHeight * 4);
+	}
+	else {
+		stbir_resize_uint8_generic(pixels, sourceWidth, sourceHeight, 0, data.storage.data(), baseWidth, baseHeight, 0,
+			4, 3, STBIR_FLAG_ALPHA_PREMULTIPLIED, STBIR_EDGE_CLAMP, STBIR_FILTER_DEFAULT, STBIR_COLORSPACE_LINEAR, nullptr);
+	}
+	stbi_image_free(pixels);
+
+	size_t offset = 0;
+	for (auto [levelWidth, levelHeight] : sizes) {
+		size_t size = static_cast<size_t>(levelWidth) * levelHeight * 4;
+		uint8_t* levelPixels = data.storage.data() + offset;
+
+		// Box filtered like glGenerateMipmap, alpha is averaged on its own instead of weighting the colors
+		if (!data.levels.empty()) {
+			auto& previous = data.levels.back();
+			stbir_resize_uint8_generic(previous.data.data(), previous.width, previous.height, 0,
+				levelPixels, levelWidth, levelHeight, 0, 4, 3, STBIR_FLAG_ALPHA_PREMULTIPLIED,
+				STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_LINEAR, nullptr);
+		}
+
+		data.levels.push_back({ levelWidth, levelHeight, { levelPixels, size } });
+		offset += size;
+	}
+
+	auto& base = data.levels.front().data;
+	for (size_t i = 3; i < base.size() && !data.translucent; i += 4) {
+		data.translucent = base[i] < 255;
+	}
+
+	return data;
+}
+
+uint64_t TextureCook::hash(std::span<const uint8_t> source, const TextureParams& params)
+{
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto mix = [&](uint8_t byte) {
+		hash ^= byte;
+		hash *= 0x100000001b3ull;
+	};
+
+	for (auto byte : source) {
+		mix(byte);
+	}
+	mix(params.flipVertically);
+	mix(params.generateMipmaps);
+	mix(static_cast<uint8_t>(cookVersion));
+
+	return hash;
+}
+
+std::filesystem::path TextureCook::cachedFile(uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bctex", static_cast<unsigned long long>(key));
+
+	return cachePath / name;
+}
+
+std::optional<TextureData> TextureCook::LoadCooked(std::span<const uint8_t> source, const TextureParams& params)
+{
+	auto key = hash(source, params);
+
+	if (auto data = mapCooked(key)) {
+		return data;
+	}
+
+	return cook(source, params, key);
+}
+
+std::optional<TextureData> TextureCook::mapCooked(uint64_t key)
+{
+	MappedFile mapping{ cachedFile(key) };
+	if (!mapping.IsValid()) {
+		return std::nullopt;
+	}
+
+	auto bytes = mapping.Data();
+	CookedHeader header{};
+	if (bytes.size() < sizeof(header)) {
+		return std::nullopt;
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, cookMagic, sizeof(cookMagic)) != 0 || header.version != cookVersion || header.key != key) {
+		return std::nullopt;
+	}
+	if (bytes.size() < sizeof(header) + header.levelCount * sizeof(CookedLevel)) {
+		return std::nullopt;
+	}
+
+	TextureData data{ .format = header.format, .translucent = header.translucent != 0 };
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		CookedLevel level{};
+		std::memcpy(&level, bytes.data() + sizeof(header) + i * sizeof(CookedLevel), sizeof(level));
+
+		// A truncated file is treated as a miss and cooked again
+		if (level.offset + level.size > bytes.size()) {
+			return std::nullopt;
+		}
+		data.levels.push_back({ static_cast<int>(level.width), static_cast<int>(level.height), bytes.subspan(level.offset, level.size) });
+	}
+	data.mapping = std::move(mapping);
+
+	return data;
+}
+
+// Pads partial blocks at the right and bottom edges by repeating the last texel
+static void compressLevel(const TextureLevel& level, bool alpha, uint8_t* destination) {
+	size_t blockBytes = alpha ? 16 : 8;
+	uint8_t block[4 * 4 * 4];
+
+	for (int by = 0; by < level.height; by += 4) {
+		for (int bx = 0; bx < level.width; bx += 4) {
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					int sx = std::min(bx + x, level.width - 1);
+					int sy = std::min(by + y, level.height - 1);
+					std::memcpy(block + (y * 4 + x) * 4, level.data.data() + (static_cast<size_t>(sy) * level.width + sx) * 4, 4);
+				}
+			}
+
+			stb_compress_dxt_block(destination, block, alpha, STB_DXT_HIGHQUAL);
+			destination += blockBytes;
+		}
+	}
+}
+
+static size_t compressedSize(int width, int height, bool alpha) {
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * (alpha ? 16 : 8);
+}
+
+std::optional<TextureData> TextureCook::cook(std::span<const uint8_t> source, const TextureParams& params, uint64_t key)
+{
+	auto decoded = Decode(source, params);
+	if (!decoded) {
+		return std::nullopt;
+	}
+
+	// Opaque textures get the 4 bits per texel format
+	bool alpha = decoded->translucent;
+	TextureData data{
+		.format = static_cast<GLenum>(alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT),
+		.translucent = alpha
+	};
+
+	size_t headerBytes = sizeof(CookedHeader) + decoded->levels.size() * sizeof(CookedLevel);
+	size_t totalBytes = headerBytes;
+	for (auto& level : decoded->levels) {
+		totalBytes += compressedSize(level.width, level.height, alpha);
+	}
+
+	// Storage is laid out exactly like the cache file, so it can be written out in one go
+	data.storage.resize(totalBytes);
+	CookedHeader header{};
+	std::memcpy(header.magic, cookMagic, sizeof(cookMagic));
+	header.version = cookVersion;
+	header.key = key;
+	header.format = data.format;
+	header.levelCount = static_cast<uint32_t>(decoded->levels.size());
+	header.translucent = alpha;
+	std::memcpy(data.storage.data(), &header, sizeof(header));
+
+	size_t offset = headerBytes;
+	for (size_t i = 0; i < decoded->levels.size(); i++) {
+		auto& level = decoded->levels[i];
+		size_t size = compressedSize(level.width, level.height, alpha);
+		compressLevel(level, alpha, data.storage.data() + offset);
+
+		CookedLevel entry{ static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), offset, size };
+		std::memcpy(data.storage.data() + sizeof(header) + i * sizeof(CookedLevel), &entry, sizeof(entry));
+
+		data.levels.push_back({ level.width, level.height, { data.storage.data() + offset, size } });
+		offset += size;
+	}
+
+	// Written under a temporary name first so other loaders never map a half written file
+	std::error_code error{};
+	std::filesystem::create_directories(cachePath, error);
+	auto target = cachedFile(key);
+	auto temporary = target;
+	temporary += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+	std::ofstream file{ temporary, std::ios::binary };
+	file.write(reinterpret_cast<const char*>(data.storage.data()), static_cast<std::streamsize>(data.storage.size()));
+	file.close();
+	// A short write must not replace a good entry, the texture is still returned from memory
+	if (!file) {
+		std::cerr << "Failed to write texture cache file: " << temporary << std::endl;
+		std::filesystem::remove(temporary, error);
+		return data;
+	}
+	std::filesystem::rename(temporary, target, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+	}
+
+	return data;
+}
+
+size_t TextureCook::CookDirectory(const std::filesystem::path& directory, const TextureParams& params)
+{
+	size_t cooked = 0;
+	std::error_code error{};
+
+	for (auto& entry : std::filesystem::directory_iterator{ directory, error }) {
+		std::vector<uint8_t> source{};
+		if (!entry.is_regular_file() || !ReadFile(entry.path(), source)) {
+			continue;
+		}
+
+		auto key = hash(source, params);
+		if (mapCooked(key)) {
+			continue;
+		}
+		if (cook(source, params, key)) {
+			cooked++;
+		}
+		else {
+			std::cerr << "Failed to cook texture: " << entry.path() << std::endl;
+		}
+	}
+
+	return cooked;
+}
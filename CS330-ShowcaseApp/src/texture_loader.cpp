@@ -0,0 +1,210 @@
+#include <texture_loader.h>
+#include <iostream>
+#include <gl_capabilities.h>
+
+TextureLoader& TextureLoader::Get()
+{
+	static TextureLoader loader{};
+	return loader;
+}
+
+TextureLoader::TextureLoader()
+{
+	startWorkers();
+}
+
+TextureLoader::~TextureLoader()
+{
+	stopWorkers();
+}
+
+void TextureLoader::startWorkers()
+{
+	// Leave one core to the render thread. The core count may be unknown, reported as 0.
+	auto cores = std::thread::hardware_concurrency();
+	auto count = cores > 1 ? cores - 1 : 1u;
+
+	_stopping = false;
+	for (unsigned i = 0; i < count; i++) {
+		_workers.emplace_back(&TextureLoader::workerLoop, this);
+	}
+}
+
+void TextureLoader::stopWorkers()
+{
+	{
+		std::lock_guard lock{ _mutex };
+		_stopping = true;
+	}
+	_jobAvailable.notify_all();
+
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+	_workers.clear();
+}
+
+void TextureLoader::Shutdown()
+{
+	stopWorkers();
+
+	_queued.clear();
+	_decoded.clear();
+	_uploading.reset();
+	_placeholder.reset();
+
+	_unpackBuffer.Reset();
+}
+
+std::shared_ptr<Texture> TextureLoader::Load(const std::filesystem::path& path, const TextureParams& params)
+{
+	if (!_placeholder) {
+		// Tiny, loading it synchronously is cheaper than showing nothing
+		_placeholder = std::make_shared<Texture>(Texture::texturePath / "debug.png");
+	}
+	if (_workers.empty()) {
+		startWorkers();
+	}
+
+	auto texture = Texture::CreatePending(_placeholder);
+	texture->_path = path;
+	texture->_params = params;
+	{
+		std::lock_guard lock{ _mutex };
+		_queued.push_back({ .texture = texture, .path = path, .params = params });
+	}
+	_jobAvailable.notify_one();
+
+	return texture;
+}
+
+void TextureLoader::workerLoop()
+{
+	while (true) {
+		Job job{};
+		{
+			std::unique_lock lock{ _mutex };
+			_jobAvailable.wait(lock, [this] { return _stopping || !_queued.empty(); });
+			if (_stopping) {
+				return;
+			}
+
+			job = std::move(_queued.front());
+			_queued.pop_front();
+			_decoding++;
+		}
+
+		// Textures dropped while queued are not worth decoding
+		bool dropped = job.texture.expired();
+		if (!dropped) {
+			decode(job);
+		}
+
+		{
+			std::lock_guard lock{ _mutex };
+			if (!dropped) {
+				_decoded.push_back(std::move(job));
+			}
+			_decoding--;
+		}
+		_jobDecoded.notify_all();
+	}
+}
+
+void TextureLoader::decode(Job& job)
+{
+	std::vector<uint8_t> source{};
+	if (!TextureCook::ReadFile(job.path, source)) {
+		// Left without levels, the texture ends up empty like a failed synchronous load
+		std::cerr << "Failed to load texture at path: " << job.path << std::endl;
+		return;
+	}
+
+	auto data = job.params.compress && GLCapabilities::Get().textureCompressionS3TC
+		? TextureCook::LoadCooked(source, job.params)
+		: TextureCook::Decode(source, job.params);
+	if (!data) {
+		std::cerr << "Failed to load texture at path: " << job.path << std::endl;
+		return;
+	}
+
+	job.data = std::move(*data);
+}
+
+size_t TextureLoader::uploadLevel(Job& job)
+{
+	auto& levels = job.data.levels;
+	auto texture = job.texture.lock();
+	if (!texture || levels.empty()) {
+		if (job.array) {
+			job.array->FreeLayer(job.layer);
+		}
+		if (texture) {
+			texture->markReady(false, nullptr, 0);
+		}
+		job.nextLevel = levels.size();
+		return 0;
+	}
+
+	if (!job.array) {
+		auto& base = levels.front();
+		job.array = TextureArray::Acquire({ job.data.format, base.width, base.height, static_cast<int>(levels.size()) });
+		job.layer = job.array->AllocateLayer();
+	}
+	if (!_unpackBuffer) {
+		_unpackBuffer = GLBuffer::Create();
+	}
+
+	auto level = static_cast<int>(job.nextLevel);
+	auto& mip = levels[job.nextLevel++];
+	auto size = static_cast<GLsizei>(mip.data.size());
+
+	// Respecifying the buffer orphans the previous level, the driver copies from it without stalling us
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _unpackBuffer.Get());
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, mip.data.data(), GL_STREAM_DRAW);
+	job.array->UploadLevel(job.layer, level, nullptr, size);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (job.nextLevel == levels.size()) {
+		texture->markReady(job.data.translucent, std::move(job.array), job.layer);
+	}
+
+	return mip.data.size();
+}
+
+void TextureLoader::Update(size_t budgetBytes)
+{
+	size_t uploaded = 0;
+
+	while (uploaded < budgetBytes || uploaded == 0) {
+		if (!_uploading) {
+			std::lock_guard lock{ _mutex };
+			if (_decoded.empty()) {
+				return;
+			}
+			_uploading = std::move(_decoded.front());
+			_decoded.pop_front();
+		}
+
+		uploaded += uploadLevel(*_uploading);
+		if (_uploading->nextLevel == _uploading->data.levels.size()) {
+			_uploading.reset();
+		}
+	}
+}
+
+bool TextureLoader::IsIdle()
+{
+	std::lock_guard lock{ _mutex };
+	return _queued.empty() && _decoding == 0 && _decoded.empty() && !_uploading;
+}
+
+void TextureLoader::Finish()
+{
+	while (!IsIdle()) {
+		Update(SIZE_MAX);
+
+		std::unique_lock lock{ _mutex };
+		_jobDecoded.wait(lock, [this] { return !_decoded.empty() || (_queued.empty() && _decoding == 0); });
+	}
+}
@@ -0,0 +1,153 @@
+#include <transform_hierarchy.h>
+#include <algorithm>
+#include <job_system.h>
+
+// Below this many nodes past the first flagged one a single pass beats the job overhead
+static constexpr size_t ParallelThreshold = 16384;
+static constexpr size_t ParallelGrain = 4096;
+
+uint32_t TransformHierarchy::Add(const glm::mat4& local, uint32_t parent)
+{
+	auto node = static_cast<uint32_t>(_local.size());
+	_parents.push_back(parent);
+	// local may point into _local, which the first push_back can move
+	_local.push_back(local);
+	_world.push_back(_local.back());
+	_dirty.push_back(1);
+	auto depth = parent == None ? 0 : _depths[parent] + 1;
+	_depths.push_back(depth);
+	if (!_levelsStale) {
+		if (depth >= _levels.size()) {
+			_levels.resize(depth + 1);
+		}
+		_levels[depth].push_back(node);
+	}
+	markDirty(node);
+
+	return node;
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const glm::mat4& local)
+{
+	_local[node] = local;
+	_dirty[node] = 1;
+	markDirty(node);
+}
+
+void TransformHierarchy::markDirty(uint32_t node)
+{
+	size_t first = _firstDirty.load(std::memory_order_relaxed);
+	while (node < first && !_firstDirty.compare_exchange_weak(first, node, std::memory_order_relaxed)) {
+	}
+}
+
+void TransformHierarchy::Erase(uint32_t first, uint32_t count)
+{
+	auto last = first + count;
+	_parents.erase(_parents.begin() + first, _parents.begin() + last);
+	_local.erase(_local.begin() + first, _local.begin() + last);
+	_world.erase(_world.begin() + first, _world.begin() + last);
+	_dirty.erase(_dirty.begin() + first, _dirty.begin() + last);
+	_depths.erase(_depths.begin() + first, _depths.begin() + last);
+	_levelsStale = true;
+	for (auto& parent : _parents) {
+		if (parent != None && parent >= last) {
+			parent -= count;
+		}
+	}
+
+	// The nodes that moved keep their world matrices, only a pending update has to follow them
+	size_t firstDirty = _firstDirty.load(std::memory_order_relaxed);
+	if (firstDirty != SIZE_MAX) {
+		_firstDirty = firstDirty >= last ? firstDirty - count : std::min<size_t>(firstDirty, first);
+	}
+}
+
+void TransformHierarchy::Clear()
+{
+	_parents.clear();
+	_local.clear();
+	_world.clear();
+	_dirty.clear();
+	_depths.clear();
+	_levels.clear();
+	_levelsStale = false;
+	_firstDirty = SIZE_MAX;
+}
+
+uint32_t TransformHierarchy::Update(std::vector<uint32_t>* changed)
+{
+	// Nothing before the first flagged node can have changed
+	size_t first = _firstDirty.load(std::memory_order_relaxed);
+	if (first == SIZE_MAX) {
+		return 0;
+	}
+
+	auto& jobs = JobSystem::Get();
+	size_t count = _local.size() - first;
+	if (count < ParallelThreshold || jobs.ThreadCount() == 1) {
+		for (size_t node = first; node < _local.size(); node++) {
+			updateNode(node);
+		}
+	}
+	else {
+		if (_levelsStale) {
+			rebuildLevels();
+		}
+
+		// Children read their parent's world matrix, so depths go one after the other
+		for (auto& level : _levels) {
+			auto start = std::lower_bound(level.begin(), level.end(), first) - level.begin();
+			jobs.ParallelFor(level.size() - start, ParallelGrain, [&](size_t begin, size_t end) {
+				for (size_t i = start + begin; i < start + end; i++) {
+					updateNode(level[i]);
+				}
+			});
+		}
+	}
+
+	// Flags stay set during the walk so children see them, every set one was recomputed
+	uint32_t updated = 0;
+	for (size_t node = first; node < _local.size(); node++) {
+		if (_dirty[node]) {
+			_dirty[node] = 0;
+			updated++;
+			if (changed) {
+				changed->push_back(static_cast<uint32_t>(node));
+			}
+		}
+	}
+	_firstDirty = SIZE_MAX;
+
+	return updated;
+}
+
+void TransformHierarchy::rebuildLevels()
+{
+	for (auto& level : _levels) {
+		level.clear();
+	}
+	for (uint32_t node = 0; node < _depths.size(); node++) {
+		if (_depths[node] >= _levels.size()) {
+			_levels.resize(_depths[node] + 1);
+		}
+		_levels[_depths[node]].push_back(node);
+	}
+	// Depths the erase emptied at the bottom would only cost an empty pass each
+	while (!_levels.empty() && _levels.back().empty()) {
+		_levels.pop_back();
+	}
+	_levelsStale = false;
+}
+
+void TransformHierarchy::updateNode(size_t node)
+{
+	auto parent = _parents[node];
+	bool parentChanged = parent != None && _dirty[parent];
+	if (!_dirty[node] && !parentChanged) {
+		return;
+	}
+
+	_world[node] = parent == None ? _local[node] : _world[parent] * _local[node];
+	_dirty[node] = 1;
+}
@@ -0,0 +1,45 @@
+#include <uniform.h>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+struct UniformRegistry {
+	std::mutex mutex;
+	// deque keeps references returned by Name() valid while new ids get added
+	std::deque<std::string> names;
+	std::unordered_map<std::string, uint32_t> indices;
+
+	static UniformRegistry& Get() {
+		static UniformRegistry registry{};
+		return registry;
+	}
+};
+
+UniformId::UniformId(const std::string& name)
+{
+	auto& registry = UniformRegistry::Get();
+	std::lock_guard lock{ registry.mutex };
+
+	auto [it, inserted] = registry.indices.try_emplace(name, static_cast<uint32_t>(registry.names.size()));
+	if (inserted) {
+		registry.names.push_back(name);
+	}
+
+	_index = it->second;
+}
+
+const std::string& UniformId::Name() const
+{
+	auto& registry = UniformRegistry::Get();
+	std::lock_guard lock{ registry.mutex };
+
+	return registry.names[_index];
+}
+
+uint32_t UniformId::Count()
+{
+	auto& registry = UniformRegistry::Get();
+	std::lock_guard lock{ registry.mutex };
+
+	return static_cast<uint32_t>(registry.names.size());
+}